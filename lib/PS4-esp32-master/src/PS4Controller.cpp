@@ -76,6 +76,29 @@ void PS4Controller::setFlashRate(uint8_t onTime, uint8_t offTime) {
 
 void PS4Controller::sendToController() { ps4SetOutput(output); }
 
+bool PS4Controller::snapshot(ps4_snapshot_t& out) {
+  uint32_t before, after;
+  do {
+    before = _seq.load(std::memory_order_acquire);
+    out = _snap;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = _seq.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+
+  return before != 0;
+}
+
+bool PS4Controller::nextButtonEvent(ps4_button_event_t& out) {
+  uint32_t tail = _event_tail.load(std::memory_order_relaxed);
+  if (tail == _event_head.load(std::memory_order_acquire)) {
+    return false;
+  }
+
+  out = _events[tail & (PS4_EVENT_QUEUE_LEN - 1)];
+  _event_tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
+
 void PS4Controller::attach(callback_t callback) { _callback_event = callback; }
 
 void PS4Controller::attachOnConnect(callback_t callback) {
@@ -93,6 +116,34 @@ void PS4Controller::_event_callback(
   memcpy(&This->data, &data, sizeof(ps4_t));
   memcpy(&This->event, &event, sizeof(ps4_event_t));
 
+  // Single writer: bump to odd, copy, bump back to even
+  uint32_t seq = This->_seq.load(std::memory_order_relaxed);
+  This->_seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  This->_snap.data = data;
+  This->_snap.seq = (seq >> 1) + 1;
+  This->_snap.stamp_us = micros();
+
+  This->_seq.store(seq + 2, std::memory_order_release);
+
+  // Queue the edges so presses shorter than the consumer's poll are kept
+  ps4_button_t down = event.button_down;
+  ps4_button_t up = event.button_up;
+  if (down | up) {
+    uint32_t head = This->_event_head.load(std::memory_order_relaxed);
+    if (head - This->_event_tail.load(std::memory_order_acquire) < PS4_EVENT_QUEUE_LEN) {
+      ps4_button_event_t& e = This->_events[head & (PS4_EVENT_QUEUE_LEN - 1)];
+      e.down = down;
+      e.up = up;
+      e.seq = (seq >> 1) + 1;
+      e.stamp_us = This->_snap.stamp_us;
+      This->_event_head.store(head + 1, std::memory_order_release);
+    } else {
+      This->_events_dropped++;
+    }
+  }
+
   if (This->_callback_event) {
     This->_callback_event();
   }
@@ -2,11 +2,29 @@
 #define PS4Controller_h
 
 #include "Arduino.h"
+#include <atomic>
 
 extern "C" {
 #include "ps4.h"
 }
 
+// One complete controller report, copied out under the sequence lock
+typedef struct {
+  ps4_t data;
+  uint32_t seq;       // report number, +1 for every report received
+  uint32_t stamp_us;  // micros() when the report arrived
+} ps4_snapshot_t;
+
+// Button edges of one report, as PS4_BUTTON_* masks
+typedef struct {
+  ps4_button_t down;
+  ps4_button_t up;
+  uint32_t seq;       // report number, matches ps4_snapshot_t.seq
+  uint32_t stamp_us;
+} ps4_button_event_t;
+
+#define PS4_EVENT_QUEUE_LEN 32  // power of 2
+
 class PS4Controller {
  public:
   typedef void (*callback_t)();
@@ -35,34 +53,43 @@ class PS4Controller {
 
   uint8_t* LatestPacket() { return data.latestPacket; }
 
+  // Consistent copy of the latest report, safe from any task while the
+  // Bluetooth task keeps writing. Returns false before the first report.
+  bool snapshot(ps4_snapshot_t& out);
+
+  // Button edge events, oldest first. Lock-free, one consumer task only.
+  // Returns false when the queue is empty.
+  bool nextButtonEvent(ps4_button_event_t& out);
+  uint32_t droppedButtonEvents() { return _events_dropped; }
+
 public:
-  bool Right() { return data.button.right; }
-  bool Down() { return data.button.down; }
-  bool Up() { return data.button.up; }
-  bool Left() { return data.button.left; }
-
-  bool Square() { return data.button.square; }
-  bool Cross() { return data.button.cross; }
-  bool Circle() { return data.button.circle; }
-  bool Triangle() { return data.button.triangle; }
-
-  bool UpRight() { return data.button.upright; }
-  bool DownRight() { return data.button.downright; }
-  bool UpLeft() { return data.button.upleft; }
-  bool DownLeft() { return data.button.downleft; }
-
-  bool L1() { return data.button.l1; }
-  bool R1() { return data.button.r1; }
-  bool L2() { return data.button.l2; }
-  bool R2() { return data.button.r2; }
-
-  bool Share() { return data.button.share; }
-  bool Options() { return data.button.options; }
-  bool L3() { return data.button.l3; }
-  bool R3() { return data.button.r3; }
-
-  bool PSButton() { return data.button.ps; }
-  bool Touchpad() { return data.button.touchpad; }
+  bool Right() { return ps4Button(data.button, PS4_BUTTON_RIGHT); }
+  bool Down() { return ps4Button(data.button, PS4_BUTTON_DOWN); }
+  bool Up() { return ps4Button(data.button, PS4_BUTTON_UP); }
+  bool Left() { return ps4Button(data.button, PS4_BUTTON_LEFT); }
+
+  bool Square() { return ps4Button(data.button, PS4_BUTTON_SQUARE); }
+  bool Cross() { return ps4Button(data.button, PS4_BUTTON_CROSS); }
+  bool Circle() { return ps4Button(data.button, PS4_BUTTON_CIRCLE); }
+  bool Triangle() { return ps4Button(data.button, PS4_BUTTON_TRIANGLE); }
+
+  bool UpRight() { return ps4Button(data.button, PS4_BUTTON_UPRIGHT); }
+  bool DownRight() { return ps4Button(data.button, PS4_BUTTON_DOWNRIGHT); }
+  bool UpLeft() { return ps4Button(data.button, PS4_BUTTON_UPLEFT); }
+  bool DownLeft() { return ps4Button(data.button, PS4_BUTTON_DOWNLEFT); }
+
+  bool L1() { return ps4Button(data.button, PS4_BUTTON_L1); }
+  bool R1() { return ps4Button(data.button, PS4_BUTTON_R1); }
+  bool L2() { return ps4Button(data.button, PS4_BUTTON_L2); }
+  bool R2() { return ps4Button(data.button, PS4_BUTTON_R2); }
+
+  bool Share() { return ps4Button(data.button, PS4_BUTTON_SHARE); }
+  bool Options() { return ps4Button(data.button, PS4_BUTTON_OPTIONS); }
+  bool L3() { return ps4Button(data.button, PS4_BUTTON_L3); }
+  bool R3() { return ps4Button(data.button, PS4_BUTTON_R3); }
+
+  bool PSButton() { return ps4Button(data.button, PS4_BUTTON_PS); }
+  bool Touchpad() { return ps4Button(data.button, PS4_BUTTON_TOUCHPAD); }
 
   uint8_t L2Value() { return data.analog.button.l2; }
   uint8_t R2Value() { return data.analog.button.r2; }
@@ -81,6 +108,16 @@ public:
   static void _event_callback(void* object, ps4_t data, ps4_event_t event);
   static void _connection_callback(void* object, uint8_t isConnected);
 
+  // Sequence lock - odd while the Bluetooth task is writing _snap
+  std::atomic<uint32_t> _seq{0};
+  ps4_snapshot_t _snap = {};
+
+  // Button event ring - written by the Bluetooth task, read by one consumer
+  ps4_button_event_t _events[PS4_EVENT_QUEUE_LEN];
+  std::atomic<uint32_t> _event_head{0};
+  std::atomic<uint32_t> _event_tail{0};
+  uint32_t _events_dropped = 0;
+
   callback_t _callback_event = nullptr;
   callback_t _callback_connect = nullptr;
   callback_t _callback_disconnect = nullptr;
@@ -33,35 +33,47 @@ typedef struct {
 /*   B U T T O N S   */
 /*********************/
 
-typedef struct {
-  uint8_t right : 1;
-  uint8_t down : 1;
-  uint8_t up : 1;
-  uint8_t left : 1;
-
-  uint8_t square : 1;
-  uint8_t cross : 1;
-  uint8_t circle : 1;
-  uint8_t triangle : 1;
-
-  uint8_t upright : 1;
-  uint8_t downright : 1;
-  uint8_t upleft : 1;
-  uint8_t downleft : 1;
-
-  uint8_t l1 : 1;
-  uint8_t r1 : 1;
-  uint8_t l2 : 1;
-  uint8_t r2 : 1;
-
-  uint8_t share : 1;
-  uint8_t options : 1;
-  uint8_t l3 : 1;
-  uint8_t r3 : 1;
-
-  uint8_t ps : 1;
-  uint8_t touchpad : 1;
-} ps4_button_t;
+/* Buttons are one packed word, one PS4_BUTTON_* bit per button */
+typedef uint32_t ps4_button_t;
+
+enum ps4_button_bit {
+  PS4_BUTTON_RIGHT = 1UL << 0,
+  PS4_BUTTON_DOWN = 1UL << 1,
+  PS4_BUTTON_UP = 1UL << 2,
+  PS4_BUTTON_LEFT = 1UL << 3,
+
+  /* Same positions as in report byte 17 */
+  PS4_BUTTON_SQUARE = 1UL << 4,
+  PS4_BUTTON_CROSS = 1UL << 5,
+  PS4_BUTTON_CIRCLE = 1UL << 6,
+  PS4_BUTTON_TRIANGLE = 1UL << 7,
+
+  PS4_BUTTON_UPRIGHT = 1UL << 8,
+  PS4_BUTTON_DOWNRIGHT = 1UL << 9,
+  PS4_BUTTON_UPLEFT = 1UL << 10,
+  PS4_BUTTON_DOWNLEFT = 1UL << 11,
+
+  /* Report byte 18 shifted up by 12 */
+  PS4_BUTTON_L1 = 1UL << 12,
+  PS4_BUTTON_R1 = 1UL << 13,
+  PS4_BUTTON_L2 = 1UL << 14,
+  PS4_BUTTON_R2 = 1UL << 15,
+
+  PS4_BUTTON_SHARE = 1UL << 16,
+  PS4_BUTTON_OPTIONS = 1UL << 17,
+  PS4_BUTTON_L3 = 1UL << 18,
+  PS4_BUTTON_R3 = 1UL << 19,
+
+  /* Report byte 19, bits 0-1, shifted up by 20 */
+  PS4_BUTTON_PS = 1UL << 20,
+  PS4_BUTTON_TOUCHPAD = 1UL << 21,
+
+  PS4_BUTTON_ALL = (1UL << 22) - 1
+};
+
+static inline bool ps4Button(ps4_button_t buttons, uint32_t mask) {
+  return (buttons & mask) != 0;
+}
 
 /*******************************/
 /*   S T A T U S   F L A G S   */
@@ -78,7 +90,10 @@ typedef struct {
 /*   S E N S O R S  */
 /********************/
 
+/* Raw, uncalibrated: gyro ~16.4 LSB per deg/s, accelerometer ~8192 LSB per g */
 typedef struct {
+  int16_t x;
+  int16_t y;
   int16_t z;
 } ps4_sensor_gyroscope_t;
 
@@ -91,6 +106,7 @@ typedef struct {
 typedef struct {
   ps4_sensor_accelerometer_t accelerometer;
   ps4_sensor_gyroscope_t gyroscope;
+  uint16_t timestamp;  /* controller clock, 16/3 us per tick, wraps */
 } ps4_sensor_t;
 
 /*******************/
@@ -1,10 +1,13 @@
 #ifndef PS4_INT_H
 #define PS4_INT_H
 
+/** Outside ESP-IDF (host builds of the parser) there is no sdkconfig */
+#ifdef ESP_PLATFORM
 #include "sdkconfig.h"
+#endif
 
 /** Check if the project is configured properly */
-#ifndef ARDUINO_ARCH_ESP32
+#if defined(ESP_PLATFORM) && !defined(ARDUINO_ARCH_ESP32)
 
 /** Check the configured blueooth mode */
 #ifdef CONFIG_BTDM_CONTROLLER_MODE_BTDM
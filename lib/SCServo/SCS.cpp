@@ -6,6 +6,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 #include "SCS.h"
 
 SCS::SCS()
@@ -58,34 +59,35 @@ u16 SCS::SCS2Host(u8 DataL, u8 DataH)
 	return Data;
 }
 
+//整帧(含校验和)组装到txBuf后一次写出
 void SCS::writeBuf(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen, u8 Fun)
 {
 	u8 msgLen = 2;
-	u8 bBuf[6];
-	u8 CheckSum = 0;
-	bBuf[0] = 0xff;
-	bBuf[1] = 0xff;
-	bBuf[2] = ID;
-	bBuf[4] = Fun;
+	txBuf[0] = 0xff;
+	txBuf[1] = 0xff;
+	txBuf[2] = ID;
+	txBuf[4] = Fun;
+	txLen = 5;
 	if(nDat){
 		msgLen += nLen + 1;
-		bBuf[3] = msgLen;
-		bBuf[5] = MemAddr;
-		writeSCS(bBuf, 6);
-		
-	}else{
-		bBuf[3] = msgLen;
-		writeSCS(bBuf, 5);
+		txBuf[5] = MemAddr;
+		memcpy(txBuf+6, nDat, nLen);
+		txLen = 6 + nLen;
 	}
-	CheckSum = ID + msgLen + Fun + MemAddr;
-	u8 i = 0;
-	if(nDat){
-		for(i=0; i<nLen; i++){
-			CheckSum += nDat[i];
-		}
-		writeSCS(nDat, nLen);
+	txBuf[3] = msgLen;
+	writePacket();
+}
+
+//计算txBuf[2]~txBuf[txLen-1]的校验和，追加后一次写出
+void SCS::writePacket()
+{
+	u8 CheckSum = 0;
+	int i;
+	for(i=2; i<txLen; i++){
+		CheckSum += txBuf[i];
 	}
-	writeSCS(~CheckSum);
+	txBuf[txLen++] = ~CheckSum;
+	writeSCS(txBuf, txLen);
 }
 
 //普通写指令
@@ -122,30 +124,43 @@ int SCS::RegWriteAction(u8 ID)
 //舵机ID[]数组，IDN数组长度，MemAddr内存表地址，写入数据，写入长度
 void SCS::syncWrite(u8 ID[], u8 IDN, u8 MemAddr, u8 *nDat, u8 nLen)
 {
-	rFlushSCS();
-	u8 mesLen = ((nLen+1)*IDN+4);
-	u8 Sum = 0;
-	u8 bBuf[7];
-	bBuf[0] = 0xff;
-	bBuf[1] = 0xff;
-	bBuf[2] = 0xfe;
-	bBuf[3] = mesLen;
-	bBuf[4] = INST_SYNC_WRITE;
-	bBuf[5] = MemAddr;
-	bBuf[6] = nLen;
-	writeSCS(bBuf, 7);
-
-	Sum = 0xfe + mesLen + INST_SYNC_WRITE + MemAddr + nLen;
-	u8 i, j;
+	u8 *Buf = syncWriteBegin(IDN, MemAddr, nLen);
+	if(!Buf){
+		return;
+	}
+	u8 i;
 	for(i=0; i<IDN; i++){
-		writeSCS(ID[i]);
-		writeSCS(nDat+i*nLen, nLen);
-		Sum += ID[i];
-		for(j=0; j<nLen; j++){
-			Sum += nDat[i*nLen+j];
-		}
+		*Buf++ = ID[i];
+		memcpy(Buf, nDat+i*nLen, nLen);
+		Buf += nLen;
 	}
-	writeSCS(~Sum);
+	syncWriteEnd();
+}
+
+//同步写帧头写入txBuf，返回第一个舵机ID位置
+//调用者按 ID,数据[nLen] 依次填入IDN组后调用syncWriteEnd，数据无需中间缓冲
+//帧长超过协议上限返回NULL
+u8 *SCS::syncWriteBegin(u8 IDN, u8 MemAddr, u8 nLen)
+{
+	int mesLen = (nLen+1)*IDN+4;
+	if(mesLen>255){
+		return NULL;
+	}
+	txBuf[0] = 0xff;
+	txBuf[1] = 0xff;
+	txBuf[2] = 0xfe;
+	txBuf[3] = mesLen;
+	txBuf[4] = INST_SYNC_WRITE;
+	txBuf[5] = MemAddr;
+	txBuf[6] = nLen;
+	txLen = 7 + (nLen+1)*IDN;
+	return txBuf+7;
+}
+
+void SCS::syncWriteEnd()
+{
+	rFlushSCS();
+	writePacket();
 	wFlushSCS();
 }
 
@@ -171,9 +186,41 @@ int SCS::writeWord(u8 ID, u8 MemAddr, u16 wDat)
 //舵机ID，MemAddr内存表地址，返回数据nData，数据长度nLen
 int SCS::Read(u8 ID, u8 MemAddr, u8 *nData, u8 nLen)
 {
+	if(!readPacketTx(ID, MemAddr, nLen)){
+		return 0;
+	}
+	return readPacketRx(ID, nData, nLen);
+}
+
+//读指令包发送，应答由readPacketRx接收
+//发送后可先处理其它任务，用readPacketReady查询应答是否到达
+//ID已断开(连续超时)时不发送，返回0
+int SCS::readPacketTx(u8 ID, u8 MemAddr, u8 nLen)
+{
+	if(!ackBeginSCS(ID)){
+		return 0;
+	}
 	rFlushSCS();
 	writeBuf(ID, MemAddr, &nLen, 1, INST_READ);
 	wFlushSCS();
+	return nLen;
+}
+
+//应答包: 0xff 0xff ID Len Error Data[nLen] CheckSum
+int SCS::readPacketReady(u8 nLen)
+{
+	return availableSCS()>=(nLen+6);
+}
+
+int SCS::readPacketRx(u8 ID, u8 *nData, u8 nLen)
+{
+	int Size = readAck(ID, nData, nLen);
+	ackEndSCS(ID, Size==nLen);
+	return Size;
+}
+
+int SCS::readAck(u8 ID, u8 *nData, u8 nLen)
+{
 	if(!checkHead()){
 		return 0;
 	}
@@ -182,6 +229,9 @@ int SCS::Read(u8 ID, u8 MemAddr, u8 *nData, u8 nLen)
 	if(readSCS(bBuf, 3)!=3){
 		return 0;
 	}
+	if(bBuf[0]!=ID && ID!=0xfe){
+		return 0;
+	}
 	int Size = readSCS(nData, nLen);
 	if(Size!=nLen){
 		return 0;
@@ -230,9 +280,19 @@ int SCS::readWord(u8 ID, u8 MemAddr)
 //Ping指令，返回舵机ID，超时返回-1
 int	SCS::Ping(u8 ID)
 {
+	if(!ackBeginSCS(ID)){
+		return -1;
+	}
 	rFlushSCS();
 	writeBuf(ID, 0, NULL, 0, INST_PING);
 	wFlushSCS();
+	int Ret = pingAck(ID);
+	ackEndSCS(ID, Ret!=-1);
+	return Ret;
+}
+
+int	SCS::pingAck(u8 ID)
+{
 	Error = 0;
 	if(!checkHead()){
 		return -1;
@@ -281,46 +341,52 @@ int	SCS::Ack(u8 ID)
 {
 	Error = 0;
 	if(ID!=0xfe && Level){
-		if(!checkHead()){
+		if(!ackBeginSCS(ID)){
 			return 0;
 		}
-		u8 bBuf[4];
-		if(readSCS(bBuf, 4)!=4){
-			return 0;
-		}
-		if(bBuf[0]!=ID){
-			return 0;
-		}
-		if(bBuf[1]!=2){
-			return 0;
-		}
-		u8 calSum = ~(bBuf[0]+bBuf[1]+bBuf[2]);
-		if(calSum!=bBuf[3]){
-			return 0;			
-		}
-		Error = bBuf[2];
+		int Ok = statusAck(ID);
+		ackEndSCS(ID, Ok);
+		return Ok;
+	}
+	return 1;
+}
+
+int	SCS::statusAck(u8 ID)
+{
+	if(!checkHead()){
+		return 0;
+	}
+	u8 bBuf[4];
+	if(readSCS(bBuf, 4)!=4){
+		return 0;
+	}
+	if(bBuf[0]!=ID){
+		return 0;
+	}
+	if(bBuf[1]!=2){
+		return 0;
 	}
+	u8 calSum = ~(bBuf[0]+bBuf[1]+bBuf[2]);
+	if(calSum!=bBuf[3]){
+		return 0;			
+	}
+	Error = bBuf[2];
 	return 1;
 }
 
 int	SCS::syncReadPacketTx(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen)
 {
 	syncReadRxPacketLen = nLen;
-	u8 checkSum = (4+0xfe)+IDN+MemAddr+nLen+INST_SYNC_READ;
-	u8 i;
-	writeSCS(0xff);
-	writeSCS(0xff);
-	writeSCS(0xfe);
-	writeSCS(IDN+4);
-	writeSCS(INST_SYNC_READ);
-	writeSCS(MemAddr);
-	writeSCS(nLen);
-	for(i=0; i<IDN; i++){
-		writeSCS(ID[i]);
-		checkSum += ID[i];
-	}
-	checkSum = ~checkSum;
-	writeSCS(checkSum);
+	txBuf[0] = 0xff;
+	txBuf[1] = 0xff;
+	txBuf[2] = 0xfe;
+	txBuf[3] = IDN+4;
+	txBuf[4] = INST_SYNC_READ;
+	txBuf[5] = MemAddr;
+	txBuf[6] = nLen;
+	memcpy(txBuf+7, ID, IDN);
+	txLen = 7 + IDN;
+	writePacket();
 	return nLen;
 }
 
@@ -328,6 +394,16 @@ int SCS::syncReadPacketRx(u8 ID, u8 *nDat)
 {
 	syncReadRxPacket = nDat;
 	syncReadRxPacketIndex = 0;
+	if(!ackBeginSCS(ID)){
+		return 0;
+	}
+	int Size = syncReadAck(ID, nDat);
+	ackEndSCS(ID, Size!=0);
+	return Size;
+}
+
+int SCS::syncReadAck(u8 ID, u8 *nDat)
+{
 	u8 bBuf[4];
 	if(!checkHead()){
 		return 0;
@@ -345,6 +421,18 @@ int SCS::syncReadPacketRx(u8 ID, u8 *nDat)
 	if(readSCS(nDat, syncReadRxPacketLen)!=syncReadRxPacketLen){
 		return 0;
 	}
+	if(readSCS(bBuf+3, 1)!=1){
+		return 0;
+	}
+	u8 calSum = bBuf[0]+bBuf[1]+bBuf[2];
+	u8 i;
+	for(i=0; i<syncReadRxPacketLen; i++){
+		calSum += nDat[i];
+	}
+	calSum = ~calSum;
+	if(calSum!=bBuf[3]){
+		return 0;
+	}
 	return syncReadRxPacketLen;
 }
 
@@ -10,7 +10,12 @@
 
 #include "INST.h"
 
+#define SCS_TX_BUF 262//最大指令包长度: 帧头6 + 数据255 + 校验和1
+
+class SCSBus;
+
 class SCS{
+	friend class SCSBus;
 public:
 	SCS();
 	SCS(u8 End);
@@ -25,6 +30,9 @@ public:
 	int readByte(u8 ID, u8 MemAddr);//读1个字节
 	int readWord(u8 ID, u8 MemAddr);//读2个字节
 	int Ping(u8 ID);//Ping指令
+	int readPacketTx(u8 ID, u8 MemAddr, u8 nLen);//读指令包发送(不等待应答)
+	int readPacketReady(u8 nLen);//读返回包是否已全部到达(非阻塞)
+	int readPacketRx(u8 ID, u8 *nData, u8 nLen);//读返回包接收，成功返回字节数，失败返回0
 	int syncReadPacketTx(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen);//同步读指令包发送
 	int syncReadPacketRx(u8 ID, u8 *nDat);//同步读返回包接收，成功返回内存字节数，失败返回0
 	int syncReadRxPacketToByte();//解码一个字节
@@ -36,17 +44,29 @@ public:
 	u8 syncReadRxPacketIndex;
 	u8 syncReadRxPacketLen;
 	u8 *syncReadRxPacket;
+	u8 txBuf[SCS_TX_BUF];//指令包缓冲区，每帧复用
+	int txLen;
 protected:
 	virtual int writeSCS(unsigned char *nDat, int nLen) = 0;
 	virtual int readSCS(unsigned char *nDat, int nLen) = 0;
 	virtual int writeSCS(unsigned char bDat) = 0;
+	virtual int availableSCS() = 0;
 	virtual void rFlushSCS() = 0;
 	virtual void wFlushSCS() = 0;
+	virtual int ackBeginSCS(u8 ID) = 0;//开始等待ID应答，返回0表示该ID已断开需跳过
+	virtual void ackEndSCS(u8 ID, int Ok) = 0;//ID应答结束，Ok为是否成功
 protected:
 	void writeBuf(u8 ID, u8 MemAddr, u8 *nDat, u8 nLen, u8 Fun);
+	void writePacket();//追加校验和，txBuf一次写出
+	u8 *syncWriteBegin(u8 IDN, u8 MemAddr, u8 nLen);//同步写帧头，返回数据区
+	void syncWriteEnd();//同步写发送
 	void Host2SCS(u8 *DataL, u8* DataH, u16 Data);//1个16位数拆分为2个8位数
 	u16	SCS2Host(u8 DataL, u8 DataH);//2个8位数组合为1个16位数
 	int	Ack(u8 ID);//返回应答
+	int	statusAck(u8 ID);//接收状态应答包
+	int	pingAck(u8 ID);//接收Ping应答包
+	int	readAck(u8 ID, u8 *nData, u8 nLen);//接收读应答包
+	int	syncReadAck(u8 ID, u8 *nDat);//接收同步读应答包
 	int checkHead();//帧头检测
 };
 #endif
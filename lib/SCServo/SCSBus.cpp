@@ -0,0 +1,324 @@
+/*
+ * SCSBus.cpp
+ * 飞特串行舵机总线调度程序
+ * 日期: 2026.10.17
+ * 作者: 
+ */
+
+#include "SCSBus.h"
+
+SCSBus::SCSBus(SCSerial *pSCS, unsigned long Baud)
+{
+	this->pSCS = pSCS;
+	this->Baud = Baud;
+	readN = 0;
+	readCur = 0;
+	holding = 0;
+	running = 0;
+	rxLen = 0;
+	resetStats();
+}
+
+void SCSBus::hold()
+{
+	if(holding){
+		return;
+	}
+	wait();
+	pSCS->holdTx(txQ, SCS_BUS_TX);
+	holding = 1;
+}
+
+int SCSBus::syncRead(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen, u8 *nDat, u8 *Ok)
+{
+	if(busy() || readN>=SCS_BUS_READS || IDN==0 || IDN>SCS_BUS_IDS){
+		return 0;
+	}
+	SCSBusRead *R = &Reads[readN++];
+	R->MemAddr = MemAddr;
+	R->nLen = nLen;
+	R->IDN = IDN;
+	R->Done = 0;
+	for(u8 i=0; i<IDN; i++){
+		R->ID[i] = ID[i];
+		R->State[i] = 0;
+		R->nDat[i] = nDat + i*nLen;
+		R->Ok[i] = Ok + i;
+		Ok[i] = 0;
+	}
+	return 1;
+}
+
+int SCSBus::read(u8 ID, u8 MemAddr, u8 nLen, u8 *nDat, u8 *Ok)
+{
+	if(busy()){
+		return 0;
+	}
+	*Ok = 0;
+	for(u8 j=0; j<readN; j++){
+		SCSBusRead *R = &Reads[j];
+		if(R->MemAddr!=MemAddr || R->nLen!=nLen || R->IDN>=SCS_BUS_IDS){
+			continue;
+		}
+		u8 i;
+		for(i=0; i<R->IDN; i++){
+			if(R->ID[i]==ID){
+				break;
+			}
+		}
+		if(i<R->IDN){
+			continue;
+		}
+		R->ID[i] = ID;
+		R->State[i] = 0;
+		R->nDat[i] = nDat;
+		R->Ok[i] = Ok;
+		R->IDN++;
+		return 1;
+	}
+	return syncRead(&ID, 1, MemAddr, nLen, nDat, Ok);
+}
+
+int SCSBus::submit()
+{
+	if(!holding){
+		hold();
+	}
+	rxLen = 0;
+	readCur = 0;
+	running = 1;
+	dispatch();
+	int Len = pSCS->holdLen;
+	pSCS->holdTx(NULL, 0);
+	holding = 0;
+	if(Len){
+		pSCS->rFlushSCS();
+		pSCS->writeSCS(txQ, Len);
+		pSCS->wFlushSCS();
+		account(Len);
+		txBytes += Len;
+	}
+	//应答最早在整段发送完成后到达
+	txAt = micros();
+	rxAt = txAt + (unsigned long)((unsigned long long)Len*10000000ULL/Baud);
+	return Len;
+}
+
+int SCSBus::poll()
+{
+	rxPump(0);
+	return !busy();
+}
+
+int SCSBus::wait()
+{
+	unsigned long T = Timeouts;
+	while(busy()){
+		rxPump(1);
+	}
+	return Timeouts - T;
+}
+
+int SCSBus::run()
+{
+	submit();
+	return wait();
+}
+
+int SCSBus::busy()
+{
+	//本批读事务全部结束后清空队列，此前入队的读不会被丢弃
+	if(running && readCur>=readN){
+		running = 0;
+		readN = 0;
+		readCur = 0;
+	}
+	return running;
+}
+
+void SCSBus::resetStats()
+{
+	busyUs = 0;
+	txBytes = 0;
+	rxBytes = 0;
+	Timeouts = 0;
+	statsAt = micros();
+}
+
+int SCSBus::Utilisation()
+{
+	unsigned long Elapsed = micros() - statsAt;
+	if(!Elapsed){
+		return 0;
+	}
+	unsigned long long U = (unsigned long long)busyUs*1000ULL/Elapsed;
+	if(U>1000){
+		U = 1000;
+	}
+	return U;
+}
+
+//断路器断开的ID不请求，直接记为失败
+void SCSBus::dispatch()
+{
+	while(readCur<readN){
+		SCSBusRead *R = &Reads[readCur];
+		u8 ID[SCS_BUS_IDS];
+		u8 IDN = 0;
+		curTimeOut = 0;
+		for(u8 i=0; i<R->IDN; i++){
+			if(!pSCS->linkOnline(R->ID[i])){
+				R->State[i] = 1;
+				R->Done++;
+				continue;
+			}
+			ID[IDN++] = R->ID[i];
+			unsigned long T = pSCS->linkTimeOut(R->ID[i]);
+			if(T>curTimeOut){
+				curTimeOut = T;
+			}
+		}
+		if(!IDN){
+			readCur++;
+			continue;
+		}
+		if(IDN==1){
+			pSCS->writeBuf(ID[0], R->MemAddr, &R->nLen, 1, INST_READ);
+		}else{
+			pSCS->syncReadPacketTx(ID, IDN, R->MemAddr, R->nLen);
+		}
+		if(!holding){
+			account(pSCS->txLen);
+			txBytes += pSCS->txLen;
+		}
+		txAt = micros();
+		rxAt = txAt + (unsigned long)((unsigned long long)pSCS->txLen*10000000ULL/Baud);
+		rxLen = 0;
+		return;
+	}
+}
+
+int SCSBus::rxPump(int Block)
+{
+	u8 Chunk[32];
+	int Cnt = 0;
+	while(busy()){
+		int n = pSCS->availableSCS();
+		if(n<=0){
+			long Left = (long)curTimeOut-(long)(micros()-rxAt);
+			if(Block && Left>=0){
+				//只等本事务剩余的超时，而非IOTimeOut；剩余不足1个RTOS tick时
+				//readSCS按micros()轮询(占用CPU)，否则阻塞在驱动上
+				unsigned long T = pSCS->rxTimeOut;
+				pSCS->rxTimeOut = Left;
+				int n = pSCS->readSCS(Chunk, 1);
+				pSCS->rxTimeOut = T;
+				if(n==1){
+					account(1);
+					rxBytes++;
+					rxAt = micros();
+					rxByte(Chunk[0]);
+					Cnt++;
+				}
+				continue;
+			}
+			if((long)(micros()-rxAt)>(long)curTimeOut){
+				finish();
+				continue;
+			}
+			break;
+		}
+		if(n>(int)sizeof(Chunk)){
+			n = sizeof(Chunk);
+		}
+		n = pSCS->readSCS(Chunk, n);
+		account(n);
+		rxBytes += n;
+		rxAt = micros();
+		for(int i=0; i<n && busy(); i++){
+			rxByte(Chunk[i]);
+		}
+		Cnt += n;
+	}
+	return Cnt;
+}
+
+//应答包: 0xff 0xff ID Len Error Data[Len-2] CheckSum
+void SCSBus::rxByte(u8 bDat)
+{
+	if(rxLen<2){
+		if(bDat==0xff){
+			rxBuf[rxLen++] = bDat;
+		}else{
+			rxLen = 0;
+		}
+		return;
+	}
+	if(rxLen==2 && bDat==0xff){
+		return;
+	}
+	rxBuf[rxLen++] = bDat;
+	if(rxLen==4 && rxBuf[3]<2){
+		rxLen = 0;
+		return;
+	}
+	if(rxLen>=4 && rxLen==rxBuf[3]+4){
+		rxPacket();
+		rxLen = 0;
+	}
+}
+
+void SCSBus::rxPacket()
+{
+	u8 Len = rxBuf[3];
+	u8 calSum = 0;
+	for(int i=2; i<Len+3; i++){
+		calSum += rxBuf[i];
+	}
+	calSum = ~calSum;
+	if(calSum!=rxBuf[Len+3]){
+		return;
+	}
+	SCSBusRead *R = &Reads[readCur];
+	if(Len-2!=R->nLen){
+		return;
+	}
+	u8 ID = rxBuf[2];
+	for(u8 i=0; i<R->IDN; i++){
+		if(R->ID[i]!=ID || R->State[i]){
+			continue;
+		}
+		memcpy(R->nDat[i], rxBuf+5, R->nLen);
+		*R->Ok[i] = 1;
+		R->State[i] = 1;
+		R->Done++;
+		pSCS->Error = rxBuf[4];
+		pSCS->linkSample(ID, 1, micros()-txAt);
+		break;
+	}
+	if(R->Done>=R->IDN){
+		readCur++;
+		dispatch();
+	}
+}
+
+void SCSBus::finish()
+{
+	SCSBusRead *R = &Reads[readCur];
+	for(u8 i=0; i<R->IDN; i++){
+		if(R->State[i]){
+			continue;
+		}
+		R->State[i] = 1;
+		Timeouts++;
+		pSCS->linkSample(R->ID[i], 0, 0);
+	}
+	R->Done = R->IDN;
+	readCur++;
+	dispatch();
+}
+
+void SCSBus::account(int nLen)
+{
+	busyUs += (unsigned long)((unsigned long long)nLen*10000000ULL/Baud);
+}
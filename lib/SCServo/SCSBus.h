@@ -0,0 +1,74 @@
+/*
+ * SCSBus.h
+ * 飞特串行舵机总线调度程序
+ * 无应答的写帧与读请求背靠背发送，应答按ID分发
+ * 日期: 2026.10.17
+ * 作者: 
+ */
+
+#ifndef _SCSBUS_H
+#define _SCSBUS_H
+
+#include "SCSerial.h"
+
+#define SCS_BUS_TX 512//单次提交的最大字节数
+#define SCS_BUS_READS 8//读事务队列长度
+#define SCS_BUS_IDS 16//单个读事务最多ID数
+
+struct SCSBusRead{
+	u8 MemAddr;
+	u8 nLen;
+	u8 IDN;
+	u8 Done;//已应答或已放弃的ID数
+	u8 ID[SCS_BUS_IDS];
+	u8 State[SCS_BUS_IDS];//0等待，1已结束
+	u8 *nDat[SCS_BUS_IDS];
+	u8 *Ok[SCS_BUS_IDS];
+};
+
+//半双工总线同一时刻只允许一个有应答的请求:
+//submit把入队的写帧和第一个读请求合成一次写出，
+//每个读请求的应答收齐(或超时)后立即发出下一个
+class SCSBus
+{
+public:
+	SCSBus(SCSerial *pSCS, unsigned long Baud = 1000000);
+	void hold();//开始暂存: 之后pSCS上的无应答写指令(syncWrite/SyncWritePosEx等)只暂存不发送，已入队的读保留
+	int syncRead(u8 ID[], u8 IDN, u8 MemAddr, u8 nLen, u8 *nDat, u8 *Ok);//同步读入队，nDat按ID顺序存放IDN*nLen字节
+	int read(u8 ID, u8 MemAddr, u8 nLen, u8 *nDat, u8 *Ok);//单个读入队，地址与长度相同的读合并为一条同步读
+	int submit();//发送入队内容，返回立即写出的字节数
+	int poll();//非阻塞处理已到达的应答，全部完成返回1
+	int wait();//阻塞至全部完成，返回本次超时的ID数
+	int run();//submit+wait
+	int busy();//有读事务未完成返回1
+	void resetStats();
+	int Utilisation();//自resetStats()以来的总线占用率(千分比)
+public:
+	unsigned long Baud;
+	unsigned long busyUs;//总线占用时间(us)，按收发字节数与波特率计算
+	unsigned long txBytes;
+	unsigned long rxBytes;
+	unsigned long Timeouts;//未应答的ID累计数
+private:
+	void dispatch();//发送下一个读请求
+	int rxPump(int Block);//读取已到达的字节，Block为1时无数据则等待
+	void rxByte(u8 bDat);//应答解包
+	void rxPacket();//完整应答包按ID分发
+	void finish();//当前读事务结束，未应答的ID记为超时
+	void account(int nLen);
+	SCSerial *pSCS;
+	u8 txQ[SCS_BUS_TX];
+	SCSBusRead Reads[SCS_BUS_READS];
+	u8 readN;//队列中读事务数
+	u8 readCur;//当前等待应答的读事务，readCur>=readN表示空闲
+	u8 holding;
+	u8 running;//已submit，读事务未全部完成
+	u8 rxBuf[SCS_TX_BUF];
+	int rxLen;
+	unsigned long rxAt;//超时计时起点(us)
+	unsigned long txAt;//当前读请求发出时间(us)
+	unsigned long curTimeOut;//当前读事务应答超时(us)
+	unsigned long statsAt;
+};
+
+#endif
@@ -58,8 +58,11 @@ int SCSCL::CalibrationOfs(u8 ID){
 
 void SCSCL::SyncWritePos(u8 ID[], u8 IDN, u16 Position[], u16 Time[], u16 Speed[])
 {
-    u8 offbuf[6*IDN];
-    for(u8 i = 0; i<IDN; i++){
+	u8 *Buf = syncWriteBegin(IDN, SCSCL_GOAL_POSITION_L, 6);
+	if(!Buf){
+		return;
+	}
+	for(u8 i = 0; i<IDN; i++){
 		u16 T, V;
 		if(Time){
 			T = Time[i];
@@ -71,11 +74,13 @@ void SCSCL::SyncWritePos(u8 ID[], u8 IDN, u16 Position[], u16 Time[], u16 Speed[
 		}else{
 			V = 0;
 		}
-        Host2SCS(offbuf+i*6+0, offbuf+i*6+1, Position[i]);
-        Host2SCS(offbuf+i*6+2, offbuf+i*6+3, T);
-        Host2SCS(offbuf+i*6+4, offbuf+i*6+5, V);
-    }
-    syncWrite(ID, IDN, SCSCL_GOAL_POSITION_L, offbuf, 6);
+		Buf[0] = ID[i];
+		Host2SCS(Buf+1, Buf+2, Position[i]);
+		Host2SCS(Buf+3, Buf+4, T);
+		Host2SCS(Buf+5, Buf+6, V);
+		Buf += 7;
+	}
+	syncWriteEnd();
 }
 
 int SCSCL::PWMMode(u8 ID)
@@ -6,46 +6,158 @@
  */
 
 
+#include <string.h>
 #include "SCSerial.h"
 
 SCSerial::SCSerial()
 {
-	IOTimeOut = 100;
+	IOTimeOut = 1000;
+	rxTimeOut = IOTimeOut;
+#if defined(ARDUINO)
 	pSerial = NULL;
+#endif
+	pSim = NULL;
+	holdBuf = NULL;
+	holdLen = 0;
+	linkReset();
+#if defined(ARDUINO_ARCH_ESP32)
+	uartPort = -1;
+	uartQueue = NULL;
+#endif
 }
 
 SCSerial::SCSerial(u8 End):SCS(End)
 {
-	IOTimeOut = 100;
+	IOTimeOut = 1000;
+	rxTimeOut = IOTimeOut;
+#if defined(ARDUINO)
 	pSerial = NULL;
+#endif
+	pSim = NULL;
+	holdBuf = NULL;
+	holdLen = 0;
+	linkReset();
+#if defined(ARDUINO_ARCH_ESP32)
+	uartPort = -1;
+	uartQueue = NULL;
+#endif
 }
 
 SCSerial::SCSerial(u8 End, u8 Level):SCS(End, Level)
 {
-	IOTimeOut = 100;
+	IOTimeOut = 1000;
+	rxTimeOut = IOTimeOut;
+#if defined(ARDUINO)
 	pSerial = NULL;
+#endif
+	pSim = NULL;
+	holdBuf = NULL;
+	holdLen = 0;
+	linkReset();
+#if defined(ARDUINO_ARCH_ESP32)
+	uartPort = -1;
+	uartQueue = NULL;
+#endif
 }
 
+#if defined(ARDUINO_ARCH_ESP32)
+//安装ESP32 UART驱动，收发经由中断/环形缓冲区完成
+//writeSCS只拷贝到发送缓冲区后立即返回，readSCS阻塞在缓冲区信号量上而不是轮询
+//同一UART不能再调用HardwareSerial::begin
+int SCSerial::begin(uart_port_t Port, int Baud, int RxPin, int TxPin)
+{
+	uart_config_t Config;
+	memset(&Config, 0, sizeof(Config));
+	Config.baud_rate = Baud;
+	Config.data_bits = UART_DATA_8_BITS;
+	Config.parity = UART_PARITY_DISABLE;
+	Config.stop_bits = UART_STOP_BITS_1;
+	Config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+	if(uart_driver_install(Port, SCS_UART_RX_BUF, SCS_UART_TX_BUF, SCS_UART_QUEUE, &uartQueue, 0)!=ESP_OK){
+		return 0;
+	}
+	if(uart_param_config(Port, &Config)!=ESP_OK ||
+	   uart_set_pin(Port, TxPin, RxPin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE)!=ESP_OK){
+		uart_driver_delete(Port);
+		uartQueue = NULL;
+		return 0;
+	}
+	//应答包之间无空闲，2个字符时间即可触发接收超时中断
+	uart_set_rx_timeout(Port, 2);
+	uartPort = Port;
+	return 1;
+}
+
+void SCSerial::end()
+{
+	if(uartPort<0){
+		return;
+	}
+	uart_driver_delete(uartPort);
+	uartPort = -1;
+	uartQueue = NULL;
+}
+#endif
+
+//超时为字节间隔(us)，每收到数据重新计时
 int SCSerial::readSCS(unsigned char *nDat, int nLen)
 {
 	int Size = 0;
-	int ComData;
-	unsigned long t_begin = millis();
+	unsigned long t_begin = micros();
 	unsigned long t_user;
+#if defined(ARDUINO_ARCH_ESP32)
+	if(uartPort>=0){
+		//已缓冲的数据直接取走；剩余时间不足1个tick时按micros()轮询，
+		//否则在环形缓冲区上阻塞1个tick，使亚毫秒超时不被tick粒度放大
+		unsigned char bDat[16];
+		const unsigned long tickUs = portTICK_PERIOD_MS*1000UL;
+		while(Size<nLen){
+			size_t Len = 0;
+			uart_get_buffered_data_len(uartPort, &Len);
+			int Want = nLen-Size;
+			if(!nDat && Want>(int)sizeof(bDat)){
+				Want = sizeof(bDat);
+			}
+			int n = 0;
+			if(Len>0){
+				if(Want>(int)Len){
+					Want = Len;
+				}
+				n = uart_read_bytes(uartPort, nDat ? nDat+Size : bDat, Want, 0);
+			}else{
+				t_user = micros() - t_begin;
+				if(t_user>rxTimeOut){
+					break;
+				}
+				if(rxTimeOut-t_user>=tickUs){
+					n = uart_read_bytes(uartPort, nDat ? nDat+Size : bDat, 1, 1);
+				}
+			}
+			if(n>0){
+				Size += n;
+				t_begin = micros();
+			}
+		}
+		return Size;
+	}
+#endif
+	int ComData;
 	while(1){
-		ComData = pSerial->read();
+		//先取时间再轮询: 任务被抢占后超时前到达的字节仍会被读到
+		t_user = micros() - t_begin;
+		ComData = rxByteSCS();
 		if(ComData!=-1){
 			if(nDat){
 				nDat[Size] = ComData;
 			}
 			Size++;
-			t_begin = millis();
-		}
-		if(Size>=nLen){
-			break;
+			t_begin = micros();
+			if(Size>=nLen){
+				break;
+			}
+			continue;
 		}
-		t_user = millis() - t_begin;
-		if(t_user>IOTimeOut){
+		if(t_user>rxTimeOut){
 			break;
 		}
 	}
@@ -57,19 +169,181 @@ int SCSerial::writeSCS(unsigned char *nDat, int nLen)
 	if(nDat==NULL){
 		return 0;
 	}
+	if(holdBuf){
+		if(holdLen+nLen>holdMax){
+			return 0;
+		}
+		memcpy(holdBuf+holdLen, nDat, nLen);
+		holdLen += nLen;
+		return nLen;
+	}
+#if defined(ARDUINO_ARCH_ESP32)
+	if(uartPort>=0){
+		return uart_write_bytes(uartPort, (const char*)nDat, nLen);
+	}
+#endif
+	if(pSim){
+		return pSim->write(nDat, nLen);
+	}
+#if defined(ARDUINO)
 	return pSerial->write(nDat, nLen);
+#else
+	return 0;
+#endif
 }
 
 int SCSerial::writeSCS(unsigned char bDat)
 {
-	return pSerial->write(&bDat, 1);
+	return writeSCS(&bDat, 1);
+}
+
+int SCSerial::availableSCS()
+{
+#if defined(ARDUINO_ARCH_ESP32)
+	if(uartPort>=0){
+		size_t Len = 0;
+		uart_get_buffered_data_len(uartPort, &Len);
+		return Len;
+	}
+#endif
+	if(pSim){
+		return pSim->available();
+	}
+#if defined(ARDUINO)
+	return pSerial->available();
+#else
+	return 0;
+#endif
+}
+
+int SCSerial::rxByteSCS()
+{
+	if(pSim){
+		return pSim->read();
+	}
+#if defined(ARDUINO)
+	return pSerial->read();
+#else
+	return -1;
+#endif
 }
 
 void SCSerial::rFlushSCS()
 {
-	while(pSerial->read()!=-1);
+	if(holdBuf){
+		return;
+	}
+#if defined(ARDUINO_ARCH_ESP32)
+	if(uartPort>=0){
+		//丢弃残留数据，溢出事件一并清除
+		uart_flush_input(uartPort);
+		xQueueReset(uartQueue);
+		return;
+	}
+#endif
+	while(rxByteSCS()!=-1);
 }
 
 void SCSerial::wFlushSCS()
 {
-}
\ No newline at end of file
+}
+
+void SCSerial::linkReset()
+{
+	memset(Link, 0, sizeof(Link));
+}
+
+int SCSerial::linkOnline(u8 ID)
+{
+	if(ID>=SCS_LINK_IDS){
+		return 1;
+	}
+	if(Link[ID].Fails<SCS_LINK_TRIP){
+		return 1;
+	}
+	return (long)(micros()-Link[ID].retryAt)>=0;
+}
+
+void SCSerial::holdTx(u8 *Buf, int Max)
+{
+	holdBuf = Buf;
+	holdMax = Max;
+	holdLen = 0;
+}
+
+//超时取 均值+4倍偏差，限制在[SCS_LINK_MIN_TIMEOUT, IOTimeOut]
+//尚无样本或上次失败时使用IOTimeOut
+unsigned long SCSerial::linkTimeOut(u8 ID)
+{
+	if(ID>=SCS_LINK_IDS){
+		return IOTimeOut;
+	}
+	SCSLink *L = &Link[ID];
+	if(!L->rttAvg || L->Fails){
+		return IOTimeOut;
+	}
+	unsigned long T = L->rttAvg + 4*(unsigned long)L->rttDev;
+	if(T<SCS_LINK_MIN_TIMEOUT){
+		T = SCS_LINK_MIN_TIMEOUT;
+	}
+	if(T>IOTimeOut){
+		T = IOTimeOut;
+	}
+	return T;
+}
+
+int SCSerial::ackBeginSCS(u8 ID)
+{
+	ackBegin = micros();
+	rxTimeOut = linkTimeOut(ID);
+	if(ID>=SCS_LINK_IDS){
+		return 1;
+	}
+	SCSLink *L = &Link[ID];
+	if(L->Fails>=SCS_LINK_TRIP){
+		if((long)(ackBegin-L->retryAt)<0){
+			return 0;
+		}
+		//半开: 放行一次探测，失败后重新计时
+		L->retryAt = ackBegin + SCS_LINK_RETRY;
+	}
+	return 1;
+}
+
+void SCSerial::ackEndSCS(u8 ID, int Ok)
+{
+	rxTimeOut = IOTimeOut;
+	linkSample(ID, Ok, micros() - ackBegin);
+}
+
+void SCSerial::linkSample(u8 ID, int Ok, unsigned long Rtt)
+{
+	if(ID>=SCS_LINK_IDS){
+		return;
+	}
+	SCSLink *L = &Link[ID];
+	if(!Ok){
+		if(L->Fails<255){
+			L->Fails++;
+		}
+		if(L->Fails==SCS_LINK_TRIP){
+			L->retryAt = micros() + SCS_LINK_RETRY;
+		}
+		return;
+	}
+	L->Fails = 0;
+	if(Rtt>0xffff){
+		Rtt = 0xffff;
+	}
+	if(!L->rttAvg){
+		L->rttAvg = Rtt;
+		L->rttDev = Rtt/2;
+		return;
+	}
+	long Err = (long)Rtt - L->rttAvg;
+	L->rttAvg += Err/8;
+	if(Err<0){
+		Err = -Err;
+	}
+	L->rttDev += (Err - L->rttDev)/4;
+}
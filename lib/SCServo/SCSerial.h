@@ -10,29 +10,85 @@
 
 #if defined(ARDUINO) && ARDUINO >= 100
 #include "Arduino.h"
-#else
+#elif defined(ARDUINO)
 #include "WProgram.h"
+#else
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 #endif
 
 #include "SCS.h"
+#include "SCSim.h"
+
+//应答超时自适应/断路器
+#define SCS_LINK_IDS 32//跟踪的ID范围(0~SCS_LINK_IDS-1)，其余ID固定使用IOTimeOut
+#define SCS_LINK_MIN_TIMEOUT 200//自适应超时下限(us)
+#define SCS_LINK_TRIP 3//连续超时次数达到后断开该ID
+#define SCS_LINK_RETRY 500000//断开后重试间隔(us)
+
+struct SCSLink{
+	u16 rttAvg;//应答延时均值(us)，0表示尚无样本
+	u16 rttDev;//应答延时平均偏差(us)
+	u8 Fails;//连续失败次数
+	unsigned long retryAt;//断开时下次允许重试的时间(us)
+};
+
+#if defined(ARDUINO_ARCH_ESP32)
+#include "driver/uart.h"
+
+#define SCS_UART_RX_BUF 256//ESP32 UART驱动接收环形缓冲区
+#define SCS_UART_TX_BUF 256//ESP32 UART驱动发送环形缓冲区(写入后立即返回)
+#define SCS_UART_QUEUE 8//ESP32 UART驱动事件队列长度
+#endif
+
+class SCSBus;
 
 class SCSerial : public SCS
 {
+	friend class SCSBus;
 public:
 	SCSerial();
 	SCSerial(u8 End);
 	SCSerial(u8 End, u8 Level);
+#if defined(ARDUINO_ARCH_ESP32)
+	int begin(uart_port_t Port, int Baud, int RxPin, int TxPin);//使用ESP32 UART驱动代替HardwareSerial
+	void end();
+#endif
 
 protected:
 	virtual int writeSCS(unsigned char *nDat, int nLen);//输出nLen字节
 	virtual int readSCS(unsigned char *nDat, int nLen);//输入nLen字节
 	virtual int writeSCS(unsigned char bDat);//输出1字节
+	virtual int availableSCS();//接收缓冲区字节数
+	int rxByteSCS();//非阻塞读1字节，无数据返回-1
 	virtual void rFlushSCS();//
 	virtual void wFlushSCS();//
+	virtual int ackBeginSCS(u8 ID);//按ID选择应答超时，断开的ID返回0
+	virtual void ackEndSCS(u8 ID, int Ok);//更新ID应答延时统计与断路器
 public:
-	unsigned long int IOTimeOut;//输入输出超时
+	unsigned long int IOTimeOut;//输入输出超时上限(us)
+	unsigned long int rxTimeOut;//当前应答超时(us)
+	SCSLink Link[SCS_LINK_IDS];//各ID应答延时统计
+	int linkOnline(u8 ID);//ID未断开或已到重试时间返回1
+	unsigned long linkTimeOut(u8 ID);//ID当前应答超时(us)
+	void linkSample(u8 ID, int Ok, unsigned long Rtt);//记录一次ID应答结果及延时(us)
+	void linkReset();//清除全部ID统计
+	void holdTx(u8 *Buf, int Max);//暂存输出到Buf而不发送，Buf为NULL时恢复
+	int holdLen;//已暂存字节数
+#if defined(ARDUINO)
 	HardwareSerial *pSerial;//串口指针
+#endif
+	SCSim *pSim;//仿真总线，非NULL时代替串口(主机环境只能使用仿真总线)
+#if defined(ARDUINO_ARCH_ESP32)
+	int uartPort;//UART驱动端口，-1表示使用pSerial
+	QueueHandle_t uartQueue;//UART驱动事件队列
+#endif
 	int Err;
+protected:
+	unsigned long ackBegin;//本次应答计时起点(us)
+	u8 *holdBuf;
+	int holdMax;
 public:
 	virtual int getErr(){  return Err;  }
 };
@@ -10,5 +10,6 @@
 
 #include "SCSCL.h"
 #include "SMS_STS.h"
+#include "SCSBus.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,333 @@
+/*
+ * SCSim.cpp
+ * 飞特SMS/STS串行舵机总线仿真
+ * 日期: 2026.10.17
+ * 作者: 
+ */
+
+#include <string.h>
+#include "SCSim.h"
+#include "SMS_STS.h"
+
+#if !defined(ARDUINO)
+#include <chrono>
+
+static const std::chrono::steady_clock::time_point simEpoch = std::chrono::steady_clock::now();
+
+unsigned long micros()
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now()-simEpoch).count();
+}
+
+unsigned long millis()
+{
+	return micros()/1000;
+}
+#endif
+
+SCSim::SCSim(unsigned long Baud)
+{
+	this->Baud = Baud;
+	latencyUs = 20;
+	dropPerMille = 0;
+	Packets = 0;
+	Replies = 0;
+	Dropped = 0;
+	BadSum = 0;
+	servoN = 0;
+	txLen = 0;
+	rxHead = 0;
+	rxCnt = 0;
+	busFree = 0;
+	Seed = 1;
+}
+
+int SCSim::addServo(u8 ID)
+{
+	if(servoN>=SCSIM_SERVOS || ID>=0xfe || find(ID)){
+		return 0;
+	}
+	SCSimServo *S = &Servo[servoN++];
+	memset(S, 0, sizeof(SCSimServo));
+	S->ID = ID;
+	S->Mem[SMS_STS_MODEL_L] = 0x09;//STS3215
+	S->Mem[SMS_STS_MODEL_H] = 0x03;
+	S->Mem[SMS_STS_ID] = ID;
+	S->Mem[SMS_STS_BAUD_RATE] = _1M;
+	S->Mem[SMS_STS_MAX_ANGLE_LIMIT_L] = 0xff;
+	S->Mem[SMS_STS_MAX_ANGLE_LIMIT_H] = 0x0f;
+	S->Mem[SMS_STS_TORQUE_ENABLE] = 1;
+	S->Mem[SMS_STS_GOAL_POSITION_L] = 0x00;
+	S->Mem[SMS_STS_GOAL_POSITION_H] = 0x08;
+	S->Mem[SMS_STS_PRESENT_POSITION_L] = 0x00;
+	S->Mem[SMS_STS_PRESENT_POSITION_H] = 0x08;
+	S->Mem[SMS_STS_PRESENT_VOLTAGE] = 120;
+	S->Mem[SMS_STS_PRESENT_TEMPERATURE] = 30;
+	S->Pos = 2048;
+	S->updateAt = micros();
+	return 1;
+}
+
+u8 *SCSim::Mem(u8 ID)
+{
+	SCSimServo *S = find(ID);
+	if(!S){
+		return NULL;
+	}
+	move(S);
+	return S->Mem;
+}
+
+SCSimServo *SCSim::find(u8 ID)
+{
+	for(int i=0; i<servoN; i++){
+		if(Servo[i].ID==ID){
+			return &Servo[i];
+		}
+	}
+	return NULL;
+}
+
+//1起始位+8数据位+1停止位
+unsigned long SCSim::byteUs(int nLen)
+{
+	return (unsigned long)((unsigned long long)nLen*10000000ULL/Baud);
+}
+
+//主机字节占用总线，指令包收齐后由舵机处理
+int SCSim::write(const u8 *nDat, int nLen)
+{
+	unsigned long Now = micros();
+	if((long)(busFree-Now)<0){
+		busFree = Now;
+	}
+	for(int i=0; i<nLen; i++){
+		busFree += byteUs(1);
+		if(txLen==0 && nDat[i]!=0xff){
+			continue;
+		}
+		if(txLen==1 && nDat[i]!=0xff){
+			txLen = 0;
+			continue;
+		}
+		if(txLen==2 && nDat[i]==0xff){
+			continue;
+		}
+		txBuf[txLen++] = nDat[i];
+		if(txLen>=4 && txLen==txBuf[3]+4){
+			packet();
+			txLen = 0;
+		}else if(txLen>=SCSIM_TX){
+			txLen = 0;
+		}
+	}
+	while((long)(busFree-micros())>(long)byteUs(SCSIM_TX_FIFO));
+	return nLen;
+}
+
+int SCSim::available()
+{
+	unsigned long Now = micros();
+	int n = 0;
+	while(n<rxCnt && (long)(Now-rxAt[(rxHead+n)%SCSIM_RX])>=0){
+		n++;
+	}
+	return n;
+}
+
+int SCSim::read()
+{
+	if(!rxCnt || (long)(micros()-rxAt[rxHead])<0){
+		return -1;
+	}
+	int bDat = rxDat[rxHead];
+	rxHead = (rxHead+1)%SCSIM_RX;
+	rxCnt--;
+	return bDat;
+}
+
+void SCSim::flush()
+{
+	//只丢弃已到期的字节，仍在线上的应答不受影响
+	while(read()!=-1);
+}
+
+void SCSim::packet()
+{
+	u8 Len = txBuf[3];
+	u8 calSum = 0;
+	for(int i=2; i<Len+3; i++){
+		calSum += txBuf[i];
+	}
+	if((u8)~calSum!=txBuf[Len+3]){
+		BadSum++;
+		return;
+	}
+	Packets++;
+	u8 ID = txBuf[2];
+	u8 Inst = txBuf[4];
+	u8 *P = txBuf+5;//参数
+	int pLen = Len-2;
+	SCSimServo *S;
+	switch(Inst){
+	case INST_PING:
+		if(ID==0xfe){
+			S = servoN ? &Servo[0] : NULL;
+		}else{
+			S = find(ID);
+		}
+		if(S){
+			reply(S, NULL, 0);
+		}
+		break;
+	case INST_READ:
+		S = find(ID);
+		if(S && pLen==2 && P[0]+P[1]<=SCSIM_MEM){
+			move(S);
+			reply(S, S->Mem+P[0], P[1]);
+		}
+		break;
+	case INST_WRITE:
+	case INST_REG_WRITE:
+		for(int i=0; i<servoN; i++){
+			S = &Servo[i];
+			if(ID!=0xfe && S->ID!=ID){
+				continue;
+			}
+			if(Inst==INST_WRITE){
+				writeMem(S, P[0], P+1, pLen-1);
+			}else if(pLen-1<=SCSIM_MEM){
+				memcpy(S->Reg, P+1, pLen-1);
+				S->regAddr = P[0];
+				S->regLen = pLen-1;
+			}
+			if(ID!=0xfe){
+				reply(S, NULL, 0);
+			}
+		}
+		break;
+	case INST_REG_ACTION:
+		for(int i=0; i<servoN; i++){
+			S = &Servo[i];
+			if((ID==0xfe || S->ID==ID) && S->regLen){
+				writeMem(S, S->regAddr, S->Reg, S->regLen);
+				S->regLen = 0;
+				if(ID!=0xfe){
+					reply(S, NULL, 0);
+				}
+			}
+		}
+		break;
+	case INST_SYNC_WRITE:
+		if(pLen>=2 && P[1]){
+			for(int i=2; i+P[1]<pLen; i+=P[1]+1){
+				S = find(P[i]);
+				if(S){
+					writeMem(S, P[0], P+i+1, P[1]);
+				}
+			}
+		}
+		break;
+	case INST_SYNC_READ:
+		//按请求中的ID顺序依次应答
+		for(int i=2; i<pLen; i++){
+			S = find(P[i]);
+			if(S && P[0]+P[1]<=SCSIM_MEM){
+				move(S);
+				reply(S, S->Mem+P[0], P[1]);
+			}
+		}
+		break;
+	}
+}
+
+void SCSim::reply(SCSimServo *S, const u8 *nDat, int nLen)
+{
+	Seed = Seed*1103515245UL + 12345UL;
+	if(dropPerMille && (Seed>>16)%1000<dropPerMille){
+		Dropped++;
+		return;
+	}
+	if(rxCnt+nLen+6>SCSIM_RX){
+		Dropped++;
+		return;
+	}
+	u8 Pkt[SCSIM_MEM+6];
+	Pkt[0] = 0xff;
+	Pkt[1] = 0xff;
+	Pkt[2] = S->ID;
+	Pkt[3] = nLen+2;
+	Pkt[4] = 0;
+	u8 calSum = Pkt[2]+Pkt[3]+Pkt[4];
+	for(int i=0; i<nLen; i++){
+		Pkt[5+i] = nDat[i];
+		calSum += nDat[i];
+	}
+	Pkt[5+nLen] = ~calSum;
+	busFree += latencyUs;
+	for(int i=0; i<nLen+6; i++){
+		busFree += byteUs(1);
+		int Tail = (rxHead+rxCnt)%SCSIM_RX;
+		rxDat[Tail] = Pkt[i];
+		rxAt[Tail] = busFree;
+		rxCnt++;
+	}
+	Replies++;
+}
+
+void SCSim::writeMem(SCSimServo *S, u8 MemAddr, const u8 *nDat, int nLen)
+{
+	if(MemAddr+nLen>SCSIM_MEM){
+		return;
+	}
+	move(S);
+	memcpy(S->Mem+MemAddr, nDat, nLen);
+}
+
+//以GOAL_SPEED(步/秒，0表示最大速度)向GOAL_POSITION运动
+void SCSim::move(SCSimServo *S)
+{
+	unsigned long Now = micros();
+	float Dt = (Now - S->updateAt)*1e-6f;
+	S->updateAt = Now;
+	u8 *M = S->Mem;
+	int Goal = M[SMS_STS_GOAL_POSITION_L] | (M[SMS_STS_GOAL_POSITION_H]<<8);
+	if(Goal&(1<<15)){
+		Goal = -(Goal&~(1<<15));
+	}
+	int Speed = M[SMS_STS_GOAL_SPEED_L] | (M[SMS_STS_GOAL_SPEED_H]<<8);
+	if(!Speed){
+		Speed = 3400;
+	}
+	float Step = Speed*Dt;
+	float Delta = Goal - S->Pos;
+	int Moving = 0;
+	int Spe = 0;
+	if(Delta>Step){
+		S->Pos += Step;
+		Moving = 1;
+		Spe = Speed;
+	}else if(Delta<-Step){
+		S->Pos -= Step;
+		Moving = 1;
+		Spe = -Speed;
+	}else{
+		S->Pos = Goal;
+	}
+	int Pos = (int)(S->Pos+0.5f);
+	if(Pos<0){
+		Pos = (-Pos)|(1<<15);
+	}
+	if(Spe<0){
+		Spe = (-Spe)|(1<<15);
+	}
+	M[SMS_STS_PRESENT_POSITION_L] = Pos&0xff;
+	M[SMS_STS_PRESENT_POSITION_H] = Pos>>8;
+	M[SMS_STS_PRESENT_SPEED_L] = Spe&0xff;
+	M[SMS_STS_PRESENT_SPEED_H] = Spe>>8;
+	M[SMS_STS_MOVING] = Moving;
+	M[SMS_STS_PRESENT_LOAD_L] = Moving ? 100 : 0;
+	M[SMS_STS_PRESENT_LOAD_H] = 0;
+	M[SMS_STS_PRESENT_CURRENT_L] = Moving ? 40 : 5;
+	M[SMS_STS_PRESENT_CURRENT_H] = 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * SCSim.h
+ * 飞特SMS/STS串行舵机总线仿真
+ * 模拟内存表、波特率字节时序、应答延时与丢包，用于无硬件测试与延时评估
+ * 日期: 2026.10.17
+ * 作者: 
+ */
+
+#ifndef _SCSIM_H
+#define _SCSIM_H
+
+#include "INST.h"
+
+#if !defined(ARDUINO)
+//主机环境: 时间由std::chrono提供
+unsigned long micros();
+unsigned long millis();
+#endif
+
+#define SCSIM_SERVOS 16//最多仿真舵机数
+#define SCSIM_MEM 71//内存表大小(至SMS_STS_PRESENT_CURRENT_H)
+#define SCSIM_RX 1024//应答字节队列长度
+#define SCSIM_TX 262//接收主机指令包缓冲区
+#define SCSIM_TX_FIFO 128//主机发送缓冲区，超出后write阻塞至总线追上
+
+struct SCSimServo{
+	u8 ID;
+	u8 Mem[SCSIM_MEM];
+	u8 Reg[SCSIM_MEM];//REG_WRITE暂存
+	u8 regAddr;
+	u8 regLen;
+	float Pos;//当前位置(步)
+	unsigned long updateAt;//上次运动更新时间(us)
+};
+
+class SCSim
+{
+public:
+	SCSim(unsigned long Baud = 1000000);
+	int addServo(u8 ID);//添加舵机，返回0表示已满或已存在
+	u8 *Mem(u8 ID);//舵机内存表，ID不存在返回NULL
+	int write(const u8 *nDat, int nLen);//主机发送
+	int read();//主机接收1字节，无到期数据返回-1
+	int available();//已到期可读的字节数
+	void flush();//丢弃未读应答
+public:
+	unsigned long Baud;
+	unsigned short latencyUs;//舵机应答延时(us)
+	unsigned short dropPerMille;//应答丢失概率(千分比)
+	unsigned long Packets;//收到的有效指令包
+	unsigned long Replies;//发出的应答包
+	unsigned long Dropped;//丢弃的应答包
+	unsigned long BadSum;//校验和错误的指令包
+private:
+	SCSimServo *find(u8 ID);
+	void packet();//处理txBuf中完整指令包
+	void reply(SCSimServo *S, const u8 *nDat, int nLen);//排队一个应答包
+	void move(SCSimServo *S);//按目标位置与速度更新当前位置
+	void writeMem(SCSimServo *S, u8 MemAddr, const u8 *nDat, int nLen);
+	unsigned long byteUs(int nLen);
+	SCSimServo Servo[SCSIM_SERVOS];
+	int servoN;
+	u8 txBuf[SCSIM_TX];
+	int txLen;
+	u8 rxDat[SCSIM_RX];
+	unsigned long rxAt[SCSIM_RX];//各字节可读时间(us)
+	int rxHead;
+	int rxCnt;
+	unsigned long busFree;//总线空闲时间(us)
+	unsigned long Seed;
+};
+
+#endif
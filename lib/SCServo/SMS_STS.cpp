@@ -52,11 +52,15 @@ int SMS_STS::RegWritePosEx(u8 ID, s16 Position, u16 Speed, u8 ACC)
 
 void SMS_STS::SyncWritePosEx(u8 ID[], u8 IDN, s16 Position[], u16 Speed[], u8 ACC[])
 {
-    u8 offbuf[7*IDN];
-    for(u8 i = 0; i<IDN; i++){
-		if(Position[i]<0){
-			Position[i] = -Position[i];
-			Position[i] |= (1<<15);
+	u8 *Buf = syncWriteBegin(IDN, SMS_STS_ACC, 7);
+	if(!Buf){
+		return;
+	}
+	for(u8 i = 0; i<IDN; i++){
+		s16 Pos = Position[i];
+		if(Pos<0){
+			Pos = -Pos;
+			Pos |= (1<<15);
 		}
 		u16 V;
 		if(Speed){
@@ -64,16 +68,18 @@ void SMS_STS::SyncWritePosEx(u8 ID[], u8 IDN, s16 Position[], u16 Speed[], u8 AC
 		}else{
 			V = 0;
 		}
+		Buf[0] = ID[i];
 		if(ACC){
-			offbuf[i*7] = ACC[i];
+			Buf[1] = ACC[i];
 		}else{
-			offbuf[i*7] = 0;
+			Buf[1] = 0;
 		}
-        Host2SCS(offbuf+i*7+1, offbuf+i*7+2, Position[i]);
-        Host2SCS(offbuf+i*7+3, offbuf+i*7+4, 0);
-        Host2SCS(offbuf+i*7+5, offbuf+i*7+6, V);
-    }
-    syncWrite(ID, IDN, SMS_STS_ACC, offbuf, 7);
+		Host2SCS(Buf+2, Buf+3, Pos);
+		Host2SCS(Buf+4, Buf+5, 0);
+		Host2SCS(Buf+6, Buf+7, V);
+		Buf += 8;
+	}
+	syncWriteEnd();
 }
 
 int SMS_STS::WheelMode(u8 ID)
@@ -126,6 +132,79 @@ int SMS_STS::FeedBack(int ID)
 	return nLen;
 }
 
+//一条INST_SYNC_READ读取PRESENT_POSITION_L~PRESENT_CURRENT_H，各舵机依次应答
+//断路器断开的ID不加入请求，避免等待不会到来的应答
+int SMS_STS::SyncFeedBack(u8 ID[], u8 IDN, SMS_STS_FeedBack *Out)
+{
+	if(IDN>SMS_STS_SYNC_MAX){
+		IDN = SMS_STS_SYNC_MAX;
+	}
+	u8 rxID[SMS_STS_SYNC_MAX];
+	u8 rxN = 0;
+	u8 i;
+	Out->IDN = IDN;
+	for(i=0; i<IDN; i++){
+		Out->ID[i] = ID[i];
+		Out->Ok[i] = linkOnline(ID[i]);
+		if(Out->Ok[i]){
+			rxID[rxN++] = ID[i];
+		}
+	}
+	if(!rxN){
+		return 0;
+	}
+	rFlushSCS();
+	syncReadPacketTx(rxID, rxN, SMS_STS_PRESENT_POSITION_L, sizeof(Mem));
+	wFlushSCS();
+	int Cnt = 0;
+	for(i=0; i<IDN; i++){
+		if(!Out->Ok[i]){
+			continue;
+		}
+		if(syncReadPacketRx(ID[i], Mem)!=sizeof(Mem)){
+			Out->Ok[i] = 0;
+			continue;
+		}
+		feedBackOut(Out, i);
+		Cnt++;
+	}
+	Err = (Cnt!=IDN);
+	return Cnt;
+}
+
+int SMS_STS::FeedBackDecode(u8 ID[], u8 IDN, const u8 *nDat, const u8 *Ok, SMS_STS_FeedBack *Out)
+{
+	if(IDN>SMS_STS_SYNC_MAX){
+		IDN = SMS_STS_SYNC_MAX;
+	}
+	int Cnt = 0;
+	Out->IDN = IDN;
+	for(u8 i=0; i<IDN; i++){
+		Out->ID[i] = ID[i];
+		Out->Ok[i] = Ok[i];
+		if(!Ok[i]){
+			continue;
+		}
+		memcpy(Mem, nDat+i*sizeof(Mem), sizeof(Mem));
+		feedBackOut(Out, i);
+		Cnt++;
+	}
+	Err = (Cnt!=IDN);
+	return Cnt;
+}
+
+void SMS_STS::feedBackOut(SMS_STS_FeedBack *Out, u8 i)
+{
+	Err = 0;
+	Out->Pos[i] = ReadPos(-1);
+	Out->Speed[i] = ReadSpeed(-1);
+	Out->Load[i] = ReadLoad(-1);
+	Out->Voltage[i] = ReadVoltage(-1);
+	Out->Temper[i] = ReadTemper(-1);
+	Out->Move[i] = ReadMove(-1);
+	Out->Current[i] = ReadCurrent(-1);
+}
+
 int SMS_STS::ReadPos(int ID)
 {
 	int Pos = -1;
@@ -54,6 +54,23 @@
 
 #include "SCSerial.h"
 
+#define SMS_STS_SYNC_MAX 16//SyncFeedBack单次最多舵机数
+#define SMS_STS_FEEDBACK_LEN (SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L+1)//单个舵机反馈字节数
+
+//SyncFeedBack结果，按ID[]顺序存放
+struct SMS_STS_FeedBack{
+	u8 IDN;
+	u8 ID[SMS_STS_SYNC_MAX];
+	u8 Ok[SMS_STS_SYNC_MAX];//本次是否收到有效应答
+	s16 Pos[SMS_STS_SYNC_MAX];
+	s16 Speed[SMS_STS_SYNC_MAX];
+	s16 Load[SMS_STS_SYNC_MAX];
+	u8 Voltage[SMS_STS_SYNC_MAX];
+	u8 Temper[SMS_STS_SYNC_MAX];
+	u8 Move[SMS_STS_SYNC_MAX];
+	s16 Current[SMS_STS_SYNC_MAX];
+};
+
 class SMS_STS : public SCSerial
 {
 public:
@@ -71,6 +88,8 @@ public:
 	virtual int LockEprom(u8 ID);//eprom加锁
 	virtual int CalibrationOfs(u8 ID);//中位校准
 	virtual int FeedBack(int ID);//反馈舵机信息
+	virtual int SyncFeedBack(u8 ID[], u8 IDN, SMS_STS_FeedBack *Out);//同步读多个舵机反馈信息，返回成功个数
+	int FeedBackDecode(u8 ID[], u8 IDN, const u8 *nDat, const u8 *Ok, SMS_STS_FeedBack *Out);//解析SCSBus读回的反馈(每ID SMS_STS_FEEDBACK_LEN字节)，返回成功个数
 	virtual int ReadPos(int ID);//读位置
 	virtual int ReadSpeed(int ID);//读速度
 	virtual int ReadLoad(int ID);//读输出至电机的电压百分比(0~1000)
@@ -80,7 +99,8 @@ public:
 	virtual int ReadCurrent(int ID);//读电流
 	virtual int ReadMode(int ID);
 private:
-	u8 Mem[SMS_STS_PRESENT_CURRENT_H-SMS_STS_PRESENT_POSITION_L+1];
+	void feedBackOut(SMS_STS_FeedBack *Out, u8 i);//Mem解析到Out第i项
+	u8 Mem[SMS_STS_FEEDBACK_LEN];
 };
 
 #endif
\ No newline at end of file
@@ -3,10 +3,11 @@
 #include "esp_bt_device.h"   // <- potrzebne do esp_bt_dev_get_address()
 #include <Adafruit_SSD1306.h>
 #include <SMS_STS.h>
+#include "mailbox.h"
 
 BluetoothSerial SerialBT;
-TaskHandle_t ScreenUpdateHandle;
-TaskHandle_t ClientCmdHandle;
+TaskHandle_t ScreenUpdateHandle;   // display task
+TaskHandle_t ClientCmdHandle;      // input task
 
 // Konfiguracja UART dla serw
 #define S_RXD 18
@@ -26,6 +27,14 @@ int foundCount = 0;
 bool scanComplete = false;
 String btAddress = "";
 
+// Requests for the display task
+enum DisplayMsg : uint8_t {
+  DISPLAY_CONNECTED,
+};
+
+SpscQueue<DisplayMsg, 8> display_queue;   // input task -> display task
+const unsigned long CONNECTED_HOLD_MS = 1000;
+
 
 extern SMS_STS st;
 
@@ -138,8 +147,27 @@ void ConnectedText() {
   display.drawLine(0, 35, 128, 35, SSD1306_WHITE);
 
   display.display(); 
-  delay(1000); 
+}
 
-  logo();
+// Display task - all OLED drawing after setup happens here, on core 0,
+// so I2C transfers and screen hold times never touch the control task
+void display_task(void* arg) {
+  unsigned long logo_at = 0;
+  DisplayMsg msg;
+
+  for (;;) {
+    while (display_queue.pop(msg)) {
+      if (msg == DISPLAY_CONNECTED) {
+        ConnectedText();
+        logo_at = millis() + CONNECTED_HOLD_MS;
+      }
+    }
 
+    if (logo_at && (long)(millis() - logo_at) >= 0) {
+      logo();
+      logo_at = 0;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(50));
+  }
 }
\ No newline at end of file
@@ -0,0 +1,103 @@
+// control.h
+
+#include <esp_timer.h>
+
+// Control scheduler - a periodic esp_timer wakes a dedicated task, which runs
+// one control tick and hands it the measured time since the previous tick.
+// Late ticks therefore advance the gait by the time that really passed.
+
+// Core layout - servo control owns core 1, input/display/telemetry run on core 0
+const BaseType_t CONTROL_CORE = 1;
+const BaseType_t IO_CORE = 0;
+
+const int CONTROL_HZ = 100;                 // default tick rate
+const int CONTROL_HZ_MAX = 200;
+const int CONTROL_MAX_LAG = 4;              // elapsed time is capped at 4 periods after a stall
+
+typedef void (*ControlTick)(uint32_t elapsed_us);
+
+struct ControlStats {
+    uint32_t ticks;
+    uint32_t overruns;      // tick body took longer than one period
+    uint32_t missed;        // timer fired again before the task woke
+    uint32_t jitter_max;    // us, |elapsed - period|
+    uint32_t jitter_avg;    // us, running average (1/16)
+    uint32_t exec_max;      // us, longest tick body
+};
+
+ControlStats control_stats;
+TaskHandle_t ControlTaskHandle = NULL;
+esp_timer_handle_t control_timer = NULL;
+ControlTick control_fn = NULL;
+uint32_t control_period_us = 0;
+
+void control_timer_cb(void* arg) {
+    xTaskNotifyGive(ControlTaskHandle);
+}
+
+void control_task(void* arg) {
+    int64_t last = esp_timer_get_time();
+    bool first = true;
+
+    for (;;) {
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t now = esp_timer_get_time();
+        uint32_t elapsed = (uint32_t)(now - last);
+        uint32_t period = control_period_us;
+        last = now;
+
+        if (pending > 1) control_stats.missed += pending - 1;
+
+        if (!first) {
+            uint32_t jitter = elapsed > period ? elapsed - period : period - elapsed;
+            if (jitter > control_stats.jitter_max) control_stats.jitter_max = jitter;
+            control_stats.jitter_avg += ((int32_t)jitter - (int32_t)control_stats.jitter_avg) / 16;
+        }
+        first = false;
+
+        if (elapsed > CONTROL_MAX_LAG * period) elapsed = CONTROL_MAX_LAG * period;
+
+        control_fn(elapsed);
+
+        uint32_t exec = (uint32_t)(esp_timer_get_time() - now);
+        if (exec > control_stats.exec_max) control_stats.exec_max = exec;
+        if (exec > period) control_stats.overruns++;
+        control_stats.ticks++;
+    }
+}
+
+void control_reset_stats() {
+    memset(&control_stats, 0, sizeof(control_stats));
+}
+
+// Change the tick rate (1..CONTROL_HZ_MAX) of a running scheduler
+void control_set_rate(int hz) {
+    if (hz < 1) hz = 1;
+    if (hz > CONTROL_HZ_MAX) hz = CONTROL_HZ_MAX;
+    control_period_us = 1000000 / hz;
+    if (control_timer == NULL) return;
+
+    esp_timer_stop(control_timer);
+    esp_timer_start_periodic(control_timer, control_period_us);
+}
+
+bool control_begin(ControlTick fn, int hz) {
+    if (control_timer != NULL) return false;
+    control_fn = fn;
+    control_reset_stats();
+
+    if (xTaskCreatePinnedToCore(control_task, "control", 4096, NULL, 5, &ControlTaskHandle, CONTROL_CORE) != pdPASS) {
+        return false;
+    }
+
+    esp_timer_create_args_t args = {};
+    args.callback = control_timer_cb;
+    args.name = "control";
+    if (esp_timer_create(&args, &control_timer) != ESP_OK) {
+        control_timer = NULL;
+        return false;
+    }
+
+    control_set_rate(hz);
+    return true;
+}
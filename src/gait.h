@@ -1,6 +1,7 @@
 // gait.h
 
 #include <math.h>
+#include <stdint.h>
 
 // Gait parameters
 const int x_amp = 30;               // x amplitude
@@ -13,23 +14,40 @@ float h = 20;                       // Height
 float t_cycle = 1.5;                // Cycle time                         
 
 // Gait control
-const unsigned long GAIT_DT = 50;           // 50ms = 0.05s
 bool running = false;
-unsigned long last_gait_time = 0;
-float gait_phase = 0.0;
+uint16_t gait_phase = 0;                    // Q16: 65536 = one full cycle, wraps naturally
+
+// Q16 phase helpers
+#define PHASE_Q16(f) ((uint16_t)((f) * 65536.0 + 0.5))
 
 enum GaitMode {
     CREEP_FORWARD,
     CREEP_BACKWARD,
-    CREEP_RIGHT,
+    CREEP_RIGHT,                            // every hip swings the same way - turns in place
     CREEP_LEFT,
+    CREEP_STRAFE_RIGHT,                     // front and rear hips swing apart - sideways
+    CREEP_STRAFE_LEFT,
+    TROT_FORWARD,                           // same directions, diagonal pairs
+    TROT_BACKWARD,
+    TROT_RIGHT,
+    TROT_LEFT,
+    TROT_STRAFE_RIGHT,
+    TROT_STRAFE_LEFT,
+    GAIT_MODE_COUNT
 };
 
+// Each style has one preset per direction, in CREEP_* order
+enum GaitStyle { GAIT_CREEP, GAIT_TROT, GAIT_STYLE_COUNT };
+const int GAIT_DIRECTIONS = TROT_FORWARD;
+
+GaitStyle gait_style = GAIT_CREEP;
+GaitStyle gait_style_next = GAIT_CREEP;     // applied at the next half cycle
+
 struct GaitParams {
-    float x_amps[4];
-    float z_amps[4];
-    float x_offsets[4];
-    float phase_offsets[4];
+    int16_t x_amps[4];
+    int16_t z_amps[4];
+    int16_t x_offsets[4];
+    uint16_t phase_offsets[4];              // Q16
 };
 
 const GaitParams GAIT_CONFIGS[] = {
@@ -38,7 +56,7 @@ const GaitParams GAIT_CONFIGS[] = {
         {-x_amp, x_amp, -x_amp, x_amp},
         {z_amp, -z_amp, -z_amp, z_amp},
         {90 - OFFSET_FRONT, 90 + OFFSET_FRONT, 90 + OFFSET_BACK, 90 - OFFSET_BACK},
-        {0.00, 0.50, 0.25, 0.75}
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.25), PHASE_Q16(0.75)}
         // {0.75, 0.25, 0.00, 0.50}
     },
     // CREEP_BACKWARD
@@ -46,7 +64,7 @@ const GaitParams GAIT_CONFIGS[] = {
         {x_amp, -x_amp, +x_amp, -x_amp},
         {z_amp, -z_amp, -z_amp, z_amp},
         {90 - OFFSET_BACK, 90 + OFFSET_BACK, 90 + OFFSET_FRONT, 90 - OFFSET_FRONT},
-        {0.25, 0.75, 0.00, 0.50}
+        {PHASE_Q16(0.25), PHASE_Q16(0.75), PHASE_Q16(0.00), PHASE_Q16(0.50)}
         // {0.50, 0.25, 0.00, 0.75}
     },
     // CREEP_RIGHT
@@ -54,54 +72,447 @@ const GaitParams GAIT_CONFIGS[] = {
         {-x_amp, -x_amp, -x_amp, -x_amp},
         {z_amp, -z_amp, -z_amp, z_amp},
         {45+x_amp/2, 135+x_amp/2, 135+x_amp/2, 45+x_amp/2},
-        {0.00, 0.50, 0.25, 0.75}
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.25), PHASE_Q16(0.75)}
     },
     // CREEP_LEFT
     {
         {x_amp, x_amp, x_amp, x_amp},
         {z_amp, -z_amp, -z_amp, z_amp},
         {45-x_amp/2, 135-x_amp/2, 135-x_amp/2, 45-x_amp/2},
-        {0.00, 0.50, 0.25, 0.75}
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.25), PHASE_Q16(0.75)}
+    },
+    // CREEP_STRAFE_RIGHT
+    {
+        {-x_amp, -x_amp, x_amp, x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45+x_amp/2, 135+x_amp/2, 135-x_amp/2, 45-x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.25), PHASE_Q16(0.75)}
+    },
+    // CREEP_STRAFE_LEFT
+    {
+        {x_amp, x_amp, -x_amp, -x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45-x_amp/2, 135-x_amp/2, 135+x_amp/2, 45+x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.25), PHASE_Q16(0.75)}
+    },
+    // TROT_FORWARD - LF+RR and RF+LR swing together, half a cycle apart
+    {
+        {-x_amp, x_amp, -x_amp, x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {90 - OFFSET_FRONT, 90 + OFFSET_FRONT, 90 + OFFSET_BACK, 90 - OFFSET_BACK},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
+    },
+    // TROT_BACKWARD
+    {
+        {x_amp, -x_amp, +x_amp, -x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {90 - OFFSET_BACK, 90 + OFFSET_BACK, 90 + OFFSET_FRONT, 90 - OFFSET_FRONT},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
+    },
+    // TROT_RIGHT
+    {
+        {-x_amp, -x_amp, -x_amp, -x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45+x_amp/2, 135+x_amp/2, 135+x_amp/2, 45+x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
+    },
+    // TROT_LEFT
+    {
+        {x_amp, x_amp, x_amp, x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45-x_amp/2, 135-x_amp/2, 135-x_amp/2, 45-x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
+    },
+    // TROT_STRAFE_RIGHT
+    {
+        {-x_amp, -x_amp, x_amp, x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45+x_amp/2, 135+x_amp/2, 135-x_amp/2, 45-x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
+    },
+    // TROT_STRAFE_LEFT
+    {
+        {x_amp, x_amp, -x_amp, -x_amp},
+        {z_amp, -z_amp, -z_amp, z_amp},
+        {45-x_amp/2, 135-x_amp/2, 135+x_amp/2, 45+x_amp/2},
+        {PHASE_Q16(0.00), PHASE_Q16(0.50), PHASE_Q16(0.50), PHASE_Q16(0.00)}
     }
 };
 
+static_assert(sizeof(GAIT_CONFIGS) / sizeof(GAIT_CONFIGS[0]) == GAIT_MODE_COUNT, "one GAIT_CONFIGS entry per GaitMode");
+static_assert(GAIT_MODE_COUNT == GAIT_STYLE_COUNT * GAIT_DIRECTIONS, "every GaitStyle needs all directions");
+
+// Cycle time of each style as a fraction of t_cycle - a trot has half the
+// stance time of a creep, so it can also cycle faster
+const float GAIT_STYLE_CYCLE[GAIT_STYLE_COUNT] = {1.0, 0.75};
+
+enum Leg { LEG_LF, LEG_RF, LEG_LR, LEG_RR };
+enum Axis { AXIS_X, AXIS_Z };
+
+const int SERVO_COUNT = 8;
+
 struct ServoMapping {
     int servo_id;
-    const char* leg;
-    const char* axis;
+    Leg leg;
+    Axis axis;
+    int trim;           // servo counts added after angle conversion
+    int min_angle;      // degrees
+    int max_angle;      // degrees
+};
+
+// Indexed by servo_id - 1
+constexpr ServoMapping SERVO_MAPPING[SERVO_COUNT] = {
+    {1, LEG_LF, AXIS_X, -25,  0,  90}, {2, LEG_LF, AXIS_Z,  15, 30, 140},
+    {3, LEG_RF, AXIS_X,  30, 90, 180}, {4, LEG_RF, AXIS_Z,   0, 40, 150},
+    {5, LEG_LR, AXIS_X, -15, 90, 180}, {6, LEG_LR, AXIS_Z,   0, 40, 150},
+    {7, LEG_RR, AXIS_X, -10,  0,  90}, {8, LEG_RR, AXIS_Z,  45, 30, 140}
 };
 
-const ServoMapping SERVO_MAPPING[8] = {
-    {1, "lf", "x"}, {2, "lf", "z"},  // Servo 1: LF X, Servo 2: LF Z
-    {3, "rf", "x"}, {4, "rf", "z"},  // Servo 3: RF X, Servo 4: RF Z
-    {5, "lr", "x"}, {6, "lr", "z"},  // Servo 5: LR X, Servo 6: LR Z
-    {7, "rr", "x"}, {8, "rr", "z"}   // Servo 7: RR X, Servo 8: RR Z
+constexpr int count_joint(Leg leg, Axis axis, int i) {
+    return i == SERVO_COUNT ? 0 :
+        (SERVO_MAPPING[i].leg == leg && SERVO_MAPPING[i].axis == axis) + count_joint(leg, axis, i + 1);
+}
+
+constexpr bool mapping_complete(int i) {
+    return i == SERVO_COUNT ? true :
+        SERVO_MAPPING[i].servo_id == i + 1 &&
+        count_joint(SERVO_MAPPING[i].leg, SERVO_MAPPING[i].axis, 0) == 1 &&
+        mapping_complete(i + 1);
+}
+
+static_assert(mapping_complete(0), "SERVO_MAPPING must list servos 1-8 in order, one per leg axis");
+
+// Sine lookup - quarter wave in Q15, 64 steps, generated at compile time.
+// The last entry repeats sin(pi/2) so interpolation never reads past the end.
+constexpr double sin_series(double x2, double term, int n) {
+    return (term < 1e-17 && term > -1e-17) ? 0.0 :
+        term + sin_series(x2, -term * x2 / ((2 * n) * (2 * n + 1)), n + 1);
+}
+
+constexpr double const_sin(double x) { return sin_series(x * x, x, 1); }
+
+#define SIN_Q15(i) ((int16_t)(const_sin((i) * M_PI / 128.0) * 32767.0 + 0.5))
+
+constexpr int16_t SIN_TABLE[66] = {
+    SIN_Q15(0), SIN_Q15(1), SIN_Q15(2), SIN_Q15(3), SIN_Q15(4), SIN_Q15(5),
+    SIN_Q15(6), SIN_Q15(7), SIN_Q15(8), SIN_Q15(9), SIN_Q15(10), SIN_Q15(11),
+    SIN_Q15(12), SIN_Q15(13), SIN_Q15(14), SIN_Q15(15), SIN_Q15(16), SIN_Q15(17),
+    SIN_Q15(18), SIN_Q15(19), SIN_Q15(20), SIN_Q15(21), SIN_Q15(22), SIN_Q15(23),
+    SIN_Q15(24), SIN_Q15(25), SIN_Q15(26), SIN_Q15(27), SIN_Q15(28), SIN_Q15(29),
+    SIN_Q15(30), SIN_Q15(31), SIN_Q15(32), SIN_Q15(33), SIN_Q15(34), SIN_Q15(35),
+    SIN_Q15(36), SIN_Q15(37), SIN_Q15(38), SIN_Q15(39), SIN_Q15(40), SIN_Q15(41),
+    SIN_Q15(42), SIN_Q15(43), SIN_Q15(44), SIN_Q15(45), SIN_Q15(46), SIN_Q15(47),
+    SIN_Q15(48), SIN_Q15(49), SIN_Q15(50), SIN_Q15(51), SIN_Q15(52), SIN_Q15(53),
+    SIN_Q15(54), SIN_Q15(55), SIN_Q15(56), SIN_Q15(57), SIN_Q15(58), SIN_Q15(59),
+    SIN_Q15(60), SIN_Q15(61), SIN_Q15(62), SIN_Q15(63), SIN_Q15(64), SIN_Q15(64)
 };
 
-void creep_gait(float x_amp, float z_amp, float x_off, float z_off, float phase, float& z, float& x) {
+// angle: 65536 = 2*pi, result in Q15
+int32_t sin_q15(uint16_t angle) {
+    uint16_t a = angle & 0x3FFF;
+    if (angle & 0x4000) a = 0x4000 - a;     // 2nd/4th quadrant mirror
+    int idx = a >> 8;
+    int32_t frac = a & 0xFF;
+    int32_t v = SIN_TABLE[idx] + (((SIN_TABLE[idx + 1] - SIN_TABLE[idx]) * frac) >> 8);
+    return (angle & 0x8000) ? -v : v;
+}
+
+int32_t cos_q15(uint16_t angle) {
+    return sin_q15(angle + 0x4000);
+}
+
+// amp * q15 rounded to nearest
+int mul_q15(int amp, int32_t q15) {
+    return (amp * q15 + (1 << 14)) >> 15;
+}
+
+void creep_gait(int x_amp, int z_amp, int x_off, int z_off, uint16_t phase, int& z, int& x) {
     // LIFT (0-25% cyklu)
-    if (phase < 0.25f) {
-        z = z_off + z_amp * sin(phase / 0.25f * M_PI);
-        x = x_off + x_amp * sin(phase / 0.25f * M_PI / 2.0f);
+    if (phase < PHASE_Q16(0.25)) {
+        z = z_off + mul_q15(z_amp, sin_q15(phase << 1));   // sin(phase / 0.25 * pi)
+        x = x_off + mul_q15(x_amp, sin_q15(phase));        // sin(phase / 0.25 * pi / 2)
     }
     // RETURN (25-100% cyklu) 
     else {
         z = z_off;  // noga na ziemi
-        float returning = (phase - 0.25f) / 0.75f;
-        x = x_off + x_amp * (1.0f - returning);  
+        // x_amp * (1 - (phase - 0.25) / 0.75) = x_amp * (1 - phase) / 0.75
+        int32_t remaining = 65536 - phase;
+        x = x_off + (x_amp * remaining * 4 + (x_amp < 0 ? -98304 : 98304)) / 196608;
     }
 }
 
-void trot_gait(float x_amp, float z_amp, float x_off, float z_off, float phase, float& z, float& x) {
+void trot_gait(int x_amp, int z_amp, int x_off, int z_off, uint16_t phase, int& z, int& x) {
     // Faza podnoszenia (0-50% cyklu)
-    if (phase < 0.5f) {
-        z = z_off + z_amp * sin(phase * 2.0f * M_PI);
-        x = x_off + x_amp * sin(phase * M_PI);
+    if (phase < PHASE_Q16(0.5)) {
+        z = z_off + mul_q15(z_amp, sin_q15(phase));        // sin(phase * 2 * pi)
+        x = x_off + mul_q15(x_amp, sin_q15(phase >> 1));   // sin(phase * pi)
     }
     // Faza powrotu (50-100% cyklu)
     else {
         z = z_off;  // noga na ziemi
-        x = x_off + x_amp * cos((phase - 0.5f) * M_PI);
+        x = x_off + mul_q15(x_amp, cos_q15((phase - PHASE_Q16(0.5)) >> 1));  // cos((phase - 0.5) * pi)
+    }
+}
+
+// Velocity command - each axis is a fraction of full stride, -1..1
+struct GaitCommand {
+    float vx;                               // forward
+    float vy;                               // strafe left
+    float wz;                               // turn left
+};
+
+const float GAIT_CMD_SLEW = 2.0;            // command change per second
+
+GaitCommand gait_target = {0, 0, 0};        // from the sticks
+GaitCommand gait_cmd = {0, 0, 0};           // slew-limited, what the legs follow
+
+float slew(float cur, float target, float max_step) {
+    if (target > cur + max_step) return cur + max_step;
+    if (target < cur - max_step) return cur - max_step;
+    return target;
+}
+
+void gait_slew(GaitCommand& cmd, const GaitCommand& target, uint32_t elapsed_us) {
+    float step = GAIT_CMD_SLEW * elapsed_us * 1e-6f;
+    cmd.vx = slew(cmd.vx, target.vx, step);
+    cmd.vy = slew(cmd.vy, target.vy, step);
+    cmd.wz = slew(cmd.wz, target.wz, step);
+}
+
+// Preset mix for a command: Q15 weights over one style's directions (from
+// the command's direction, summing to one) and a Q15 stride scale from its
+// magnitude. Lift is not scaled, so slow walking still clears the ground.
+//
+// The direction is undefined at zero, so reversing vx would swap the whole
+// mix in one tick. Swing amplitudes can take that (stride is zero there),
+// but hip and phase offsets differ between opposite presets. Those follow a
+// second set of stance weights, which ease towards CREEP_FORWARD - the rest
+// mix - once the command is shorter than GAIT_STANCE_BAND. The stance then
+// changes by at most 1/GAIT_STANCE_BAND of a preset per unit of command, also
+// for a command passing close to zero rather than through it.
+const float GAIT_STANCE_BAND = 0.5;         // sum of |axes|
+
+struct GaitBlend {
+    GaitStyle style;
+    int32_t weight[GAIT_DIRECTIONS];        // indexed like CREEP_*; swing amplitudes
+    int32_t stance[GAIT_DIRECTIONS];        // hip offsets, lift and phase offsets
+    int32_t stride;
+};
+
+// Q15 weights proportional to a[], sum > 0. Rounding leftovers go to the
+// largest weight so the sum is exact.
+void gait_weights_q15(const float a[GAIT_DIRECTIONS], float sum, int32_t w[GAIT_DIRECTIONS]) {
+    int32_t total = 0;
+    int top = 0;
+    for (int d = 0; d < GAIT_DIRECTIONS; d++) {
+        w[d] = (int32_t)(a[d] / sum * 32768 + 0.5f);
+        total += w[d];
+        if (w[d] > w[top]) top = d;
+    }
+    w[top] += 32768 - total;
+}
+
+GaitBlend gait_blend(const GaitCommand& cmd, GaitStyle style) {
+    float a[GAIT_DIRECTIONS];
+    a[CREEP_FORWARD] = cmd.vx > 0 ? cmd.vx : 0;
+    a[CREEP_BACKWARD] = cmd.vx < 0 ? -cmd.vx : 0;
+    a[CREEP_LEFT] = cmd.wz > 0 ? cmd.wz : 0;
+    a[CREEP_RIGHT] = cmd.wz < 0 ? -cmd.wz : 0;
+    a[CREEP_STRAFE_LEFT] = cmd.vy > 0 ? cmd.vy : 0;
+    a[CREEP_STRAFE_RIGHT] = cmd.vy < 0 ? -cmd.vy : 0;
+
+    float sum = 0;
+    for (int d = 0; d < GAIT_DIRECTIONS; d++) sum += a[d];
+
+    GaitBlend b;
+    b.style = style;
+
+    // Stance: a[] plus the rest mix for whatever the command lacks of the
+    // band, so it is exactly the command's mix from the band up
+    float rest = sum < GAIT_STANCE_BAND ? GAIT_STANCE_BAND - sum : 0;
+    a[CREEP_FORWARD] += rest;
+    gait_weights_q15(a, sum + rest, b.stance);
+    a[CREEP_FORWARD] -= rest;
+
+    if (sum <= 0) {
+        for (int d = 0; d < GAIT_DIRECTIONS; d++) b.weight[d] = 0;
+        b.weight[CREEP_FORWARD] = 32768;
+        b.stride = 0;
+        return b;
+    }
+    gait_weights_q15(a, sum, b.weight);
+
+    float mag = sqrtf(cmd.vx * cmd.vx + cmd.vy * cmd.vy + cmd.wz * cmd.wz);
+    b.stride = mag >= 1 ? 32768 : (int32_t)(mag * 32768 + 0.5f);
+    return b;
+}
+
+// Preset of a blend's style and direction
+const GaitParams& blend_preset(const GaitBlend& b, int dir) {
+    return GAIT_CONFIGS[b.style * GAIT_DIRECTIONS + dir];
+}
+
+// Preset with the largest share of a blend
+GaitMode gait_dominant(const GaitBlend& b) {
+    int top = 0;
+    for (int d = 1; d < GAIT_DIRECTIONS; d++) {
+        if (b.weight[d] > b.weight[top]) top = d;
+    }
+    return (GaitMode)(b.style * GAIT_DIRECTIONS + top);
+}
+
+// One leg's parameters for a blend - swing amplitude from the direction
+// weights, everything else from the stance weights. Phase offsets are mixed
+// as signed Q16 distances from the style's first preset, so offsets a
+// quarter cycle apart slide into each other instead of wrapping.
+struct LegGait {
+    int x_amp, z_amp;
+    int x_mid;                              // middle of the hip sweep, half degrees
+    uint16_t phase_off;
+};
+
+LegGait blend_leg(const GaitBlend& b, int leg) {
+    const GaitParams& ref = blend_preset(b, 0);
+    int32_t x_amp = 0, z_amp = 0, x_mid = 0, dphase = 0;
+
+    for (int d = 0; d < GAIT_DIRECTIONS; d++) {
+        const GaitParams& p = blend_preset(b, d);
+        x_amp += b.weight[d] * p.x_amps[leg];
+        int32_t w = b.stance[d];
+        if (w == 0) continue;
+        z_amp += w * p.z_amps[leg];
+        x_mid += w * (2 * p.x_offsets[leg] + p.x_amps[leg]);
+        dphase += w * (int16_t)(p.phase_offsets[leg] - ref.phase_offsets[leg]);
+    }
+
+    LegGait g;
+    g.x_amp = (x_amp + (1 << 14)) >> 15;
+    g.z_amp = (z_amp + (1 << 14)) >> 15;
+    g.x_mid = (x_mid + (1 << 14)) >> 15;
+    g.phase_off = ref.phase_offsets[leg] + ((dphase + (1 << 14)) >> 15);
+    return g;
+}
+
+// Leg parameter cache - the mix depends only on the style and the weights,
+// which stay put while the stick is held (a speed change alone only moves
+// the stride), so all four legs are remixed only when those change
+struct LegGaitCache {
+    bool valid;
+    GaitStyle style;
+    int32_t weight[GAIT_DIRECTIONS];
+    int32_t stance[GAIT_DIRECTIONS];
+    LegGait leg[4];
+};
+
+LegGaitCache leg_gait_cache = {};
+
+const LegGait* blend_legs(const GaitBlend& b) {
+    LegGaitCache& c = leg_gait_cache;
+    bool same = c.valid && c.style == b.style;
+    for (int d = 0; same && d < GAIT_DIRECTIONS; d++) {
+        same = c.weight[d] == b.weight[d] && c.stance[d] == b.stance[d];
+    }
+    if (!same) {
+        c.style = b.style;
+        for (int d = 0; d < GAIT_DIRECTIONS; d++) {
+            c.weight[d] = b.weight[d];
+            c.stance[d] = b.stance[d];
+        }
+        for (int i = 0; i < 4; i++) c.leg[i] = blend_leg(b, i);
+        c.valid = true;
+    }
+    return c.leg;
+}
+
+// Curve shape of a style, lift and stride each 0..GAIT_UNIT
+const int GAIT_SHIFT = 10;
+const int GAIT_UNIT = 1 << GAIT_SHIFT;
+
+void gait_shape_curve(GaitStyle style, uint16_t phase, int& lift, int& stride) {
+    if (style == GAIT_TROT) {
+        trot_gait(GAIT_UNIT, GAIT_UNIT, 0, 0, phase, lift, stride);
+    } else {
+        creep_gait(GAIT_UNIT, GAIT_UNIT, 0, 0, phase, lift, stride);
+    }
+}
+
+// Shape cache - each style's curve baked at GAIT_SHAPE_STEPS points per
+// cycle. The shapes depend on the style alone (presets, h and the command
+// only scale and offset them), so one bake covers every parameter change.
+// The curves are continuous and their kinks fall on table points, so
+// interpolating between points stays within a unit of the exact curve.
+const int GAIT_SHAPE_BITS = 8;
+const int GAIT_SHAPE_STEPS = 1 << GAIT_SHAPE_BITS;
+const int GAIT_SHAPE_FRAC = 16 - GAIT_SHAPE_BITS;
+
+int16_t gait_shape_lift[GAIT_STYLE_COUNT][GAIT_SHAPE_STEPS + 1];
+int16_t gait_shape_stride[GAIT_STYLE_COUNT][GAIT_SHAPE_STEPS + 1];
+bool gait_shapes_baked = false;
+
+void bake_gait_shapes() {
+    for (int s = 0; s < GAIT_STYLE_COUNT; s++) {
+        for (int i = 0; i <= GAIT_SHAPE_STEPS; i++) {
+            int lift, stride;
+            gait_shape_curve((GaitStyle)s, (uint16_t)(i << GAIT_SHAPE_FRAC), lift, stride);
+            gait_shape_lift[s][i] = lift;
+            gait_shape_stride[s][i] = stride;
+        }
     }
+    gait_shapes_baked = true;
+}
+
+void gait_shape(GaitStyle style, uint16_t phase, int& lift, int& stride) {
+    if (!gait_shapes_baked) bake_gait_shapes();
+    int i = phase >> GAIT_SHAPE_FRAC;
+    int32_t frac = phase & ((1 << GAIT_SHAPE_FRAC) - 1);
+    const int16_t* l = gait_shape_lift[style];
+    const int16_t* s = gait_shape_stride[style];
+    const int32_t half = 1 << (GAIT_SHAPE_FRAC - 1);
+    lift = l[i] + (((l[i + 1] - l[i]) * frac + half) >> GAIT_SHAPE_FRAC);
+    stride = s[i] + (((s[i + 1] - s[i]) * frac + half) >> GAIT_SHAPE_FRAC);
+}
+
+// Style changes wait for a half-cycle boundary, where the trot pairs swap
+// support and no leg is in mid-swing in either style
+void gait_select(GaitStyle style) {
+    gait_style_next = style;
+    if (!running) gait_style = style;
+}
+
+// True when the style changed
+bool gait_style_update(uint16_t prev_phase, uint16_t phase) {
+    if (gait_style_next == gait_style || !((prev_phase ^ phase) & 0x8000)) return false;
+    gait_style = gait_style_next;
+    return true;
 }
 
+void calculate_gait_angles(const GaitBlend& b, uint16_t phase, float height, int angles[4][2]) {
+    // Dynamic z_offsets based on height
+    int hi = (int)height;
+    int dynamic_z_offsets[4] = {90-hi, 90+hi, 90+hi, 90-hi};
+    int32_t stride = b.stride >> 5;         // Q10
+
+    const LegGait* legs = blend_legs(b);
+
+    for (int i = 0; i < 4; i++) {
+        const LegGait& g = legs[i];
+        int lift, s;
+        gait_shape(b.style, phase + g.phase_off, lift, s);     // Q16 wraps at 1.0
+
+        // Swing scaled about the middle of the preset's sweep, in half degrees
+        int32_t swing = ((2 * s - GAIT_UNIT) * g.x_amp * stride + (1 << 19)) >> 20;
+        angles[i][0] = (g.x_mid + swing + 1) >> 1;
+        angles[i][1] = dynamic_z_offsets[i] + ((g.z_amp * lift + GAIT_UNIT / 2) >> GAIT_SHIFT);
+    }
+}
+
+// Q16 phase advance for elapsed_us at the current cycle time. The division
+// remainder is carried over so fast ticks do not lose phase to truncation.
+uint32_t phase_rem = 0;
+
+uint16_t phase_advance(uint32_t elapsed_us) {
+    uint32_t cycle_us = (uint32_t)(t_cycle * GAIT_STYLE_CYCLE[gait_style] * 1000000);
+    uint64_t num = (uint64_t)elapsed_us * 65536 + phase_rem;
+    phase_rem = num % cycle_us;
+    return (uint16_t)(num / cycle_us);
+}
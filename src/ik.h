@@ -0,0 +1,160 @@
+// ik.h
+
+// Foot-space gaits - each leg has a hip yaw servo (AXIS_X) and a lift servo
+// (AXIS_Z) carrying a rigid femur + tibia. Gaits place feet in body
+// coordinates (mm, x forward, y left, z up, origin at body centre) and a
+// closed-form solver turns them into servo angles, so stride length and
+// foot lift stay the same at every body height.
+//
+// The link lengths and hip positions are unmeasured placeholders, chosen so
+// the servo angle conventions below reproduce the existing neutral pose (legs
+// on the diagonals); measure them on the robot before trusting mm values.
+
+const float LEG_FEMUR = 60.0;               // mm, lift axis to knee
+const float LEG_TIBIA = 35.0;               // mm, knee to foot (fixed knee)
+const float HIP_X = 40.0;                   // mm, hip axis from body centre
+const float HIP_Y = 40.0;
+const float FOOT_LIFT = 15.0;               // mm, swing height
+
+struct LegGeometry {
+    float hip_x, hip_y;
+    float yaw_offset;                       // deg, body yaw = servo angle + offset
+    float lift_sign;                        // lift angle = sign * (servo angle - 90)
+};
+
+// Indexed by Leg
+const LegGeometry LEG_GEOMETRY[4] = {
+    { HIP_X,  HIP_Y,    0, -1},             // LF
+    { HIP_X, -HIP_Y, -180,  1},             // RF
+    {-HIP_X,  HIP_Y,    0,  1},             // LR
+    {-HIP_X, -HIP_Y, -180, -1},             // RR
+};
+
+// Femur and tibia act as one rigid link of LEG_REACH, bent by LEG_BEND
+const float LEG_REACH = sqrtf(LEG_FEMUR * LEG_FEMUR + LEG_TIBIA * LEG_TIBIA);
+const float LEG_BEND = atan2f(LEG_TIBIA, LEG_FEMUR);
+
+// Off until the geometry above is measured - Triangle toggles it to try out
+bool gait_foot_space = false;               // false = joint-space curves (gait.h)
+
+// Foot targets for all legs, one array per coordinate so the solver runs
+// the same straight-line code over four lanes
+struct FootTargets {
+    float x[4];
+    float y[4];
+    float z[4];
+};
+
+// Body height (foot depth below the hips, mm) for a lift angle in degrees -
+// keeps h's meaning from the joint-space gaits
+float ik_body_height(float h_deg) {
+    return LEG_REACH * sinf(radians(h_deg) + LEG_BEND);
+}
+
+// Foot position of one leg from servo angles (degrees)
+void leg_fk(int leg, float x_deg, float z_deg, float& x, float& y, float& z) {
+    const LegGeometry& g = LEG_GEOMETRY[leg];
+    float yaw = radians(x_deg + g.yaw_offset);
+    float lift = radians(g.lift_sign * (z_deg - 90)) + LEG_BEND;
+    float r = LEG_REACH * cosf(lift);
+
+    x = g.hip_x + r * cosf(yaw);
+    y = g.hip_y + r * sinf(yaw);
+    z = -LEG_REACH * sinf(lift);
+}
+
+// Closed-form IK for all four legs. With two joints per leg the foot height
+// sets the lift angle and the foot direction sets the yaw; the radius follows
+// from those, so targets off that surface are projected onto it.
+void ik_solve(const FootTargets& t, int angles[4][2]) {
+    float yaw[4], lift[4];
+
+    for (int i = 0; i < 4; i++) {
+        float s = -t.z[i] / LEG_REACH;
+        s = s > 1 ? 1 : (s < -1 ? -1 : s);
+        yaw[i] = atan2f(t.y[i] - LEG_GEOMETRY[i].hip_y, t.x[i] - LEG_GEOMETRY[i].hip_x);
+        lift[i] = asinf(s) - LEG_BEND;
+    }
+
+    for (int i = 0; i < 4; i++) {
+        float x_deg = degrees(yaw[i]) - LEG_GEOMETRY[i].yaw_offset;
+        if (x_deg < 0) x_deg += 360;
+        if (x_deg >= 360) x_deg -= 360;
+        float z_deg = 90 + LEG_GEOMETRY[i].lift_sign * degrees(lift[i]);
+
+        angles[i][AXIS_X] = (int)lroundf(x_deg);
+        angles[i][AXIS_Z] = (int)lroundf(z_deg);
+    }
+}
+
+// Stride chord of every preset in foot space - each leg moves along the
+// straight line its GAIT_CONFIGS hip swing would sweep at this height.
+// Rebuilt only when h changes; ticks just mix the chords.
+struct FootStride {
+    float cx[4], cy[4];                     // chord midpoint
+    float dx[4], dy[4];                     // chord, swing start to end
+};
+
+FootStride foot_strides[GAIT_MODE_COUNT];
+float foot_strides_h = -1;                  // h the chords were built for
+float foot_height = 0;                      // body height at that h, mm
+
+void bake_foot_strides(float h_deg) {
+    for (int m = 0; m < GAIT_MODE_COUNT; m++) {
+        const GaitParams& params = GAIT_CONFIGS[m];
+        FootStride& fs = foot_strides[m];
+
+        for (int i = 0; i < 4; i++) {
+            float z_deg = 90 + LEG_GEOMETRY[i].lift_sign * h_deg;
+            float x0, y0, x1, y1, z;
+            leg_fk(i, params.x_offsets[i], z_deg, x0, y0, z);
+            leg_fk(i, params.x_offsets[i] + params.x_amps[i], z_deg, x1, y1, z);
+
+            fs.cx[i] = (x0 + x1) / 2;
+            fs.cy[i] = (y0 + y1) / 2;
+            fs.dx[i] = x1 - x0;
+            fs.dy[i] = y1 - y0;
+        }
+    }
+    foot_strides_h = h_deg;
+    foot_height = ik_body_height(h_deg);
+}
+
+// Gait in foot space for a preset blend - chord midpoints are mixed with the
+// stance weights and chords with the direction weights (as in blend_leg), the
+// swing is scaled by its stride and the foot lifts FOOT_LIFT mm whatever the
+// speed
+void foot_gait_targets(const GaitBlend& b, uint16_t phase, float h_deg, FootTargets& out) {
+    if (h_deg != foot_strides_h) bake_foot_strides(h_deg);
+    float stride = b.stride / 32768.0f;
+    const LegGait* legs = blend_legs(b);
+
+    for (int i = 0; i < 4; i++) {
+        float cx = 0, cy = 0, dx = 0, dy = 0;
+        for (int d = 0; d < GAIT_DIRECTIONS; d++) {
+            if (b.weight[d] == 0 && b.stance[d] == 0) continue;
+            const FootStride& fs = foot_strides[b.style * GAIT_DIRECTIONS + d];
+            float w = b.weight[d] / 32768.0f;
+            float ws = b.stance[d] / 32768.0f;
+            cx += ws * fs.cx[i];
+            cy += ws * fs.cy[i];
+            dx += w * fs.dx[i];
+            dy += w * fs.dy[i];
+        }
+
+        // Shape of the joint-space curve, normalised to 0..GAIT_UNIT
+        int lift, s;
+        gait_shape(b.style, phase + legs[i].phase_off, lift, s);
+
+        float k = stride * ((float)s / GAIT_UNIT - 0.5f);
+        out.x[i] = cx + k * dx;
+        out.y[i] = cy + k * dy;
+        out.z[i] = -foot_height + FOOT_LIFT * lift / GAIT_UNIT;
+    }
+}
+
+void calculate_gait_angles_ik(const GaitBlend& b, uint16_t phase, float h_deg, int angles[4][2]) {
+    FootTargets feet;
+    foot_gait_targets(b, phase, h_deg, feet);
+    ik_solve(feet, angles);
+}
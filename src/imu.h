@@ -0,0 +1,121 @@
+// imu.h
+
+// Controller orientation - a Mahony filter updated from every HID report in
+// the Bluetooth task (PS4.attach), so tilting the controller can steer the
+// body pose without waiting for the input or control task to poll
+
+const float IMU_GYRO_LSB_PER_DPS = 16.4;    // nominal, uncalibrated
+const float IMU_ACC_LSB_PER_G = 8192.0;     // nominal, uncalibrated
+const float IMU_TICK_US = 16.0 / 3.0;       // report timestamp unit
+const float IMU_KP = 2.0;                   // accelerometer correction gain
+const float IMU_KI = 0.05;                  // gyro bias integral gain
+const float IMU_MAX_DT = 0.1;               // s, larger gaps re-seed the filter
+const float IMU_TILT_FULL_DEG = 30.0;       // controller tilt for full body tilt
+
+struct ImuFilter {
+    float q0, q1, q2, q3;                   // orientation quaternion
+    float ix, iy, iz;                       // integral feedback
+    bool seeded;
+    uint16_t last_stamp;
+};
+
+struct ImuPose {
+    float q[4];
+    float vx, vy, vz;                       // gravity direction in controller frame
+    uint32_t seq;                           // 0 = no estimate yet
+    uint32_t stamp_us;
+};
+
+ImuFilter imu_filter = {1, 0, 0, 0, 0, 0, 0, false, 0};
+Mailbox<ImuPose> imu_mailbox;               // Bluetooth task -> control task
+uint32_t imu_seq = 0;
+
+// Start from the measured gravity so the estimate is valid on the first report
+void mahony_seed(ImuFilter& f, float ax, float ay, float az) {
+    float n = sqrtf(ax*ax + ay*ay + az*az);
+    f.ix = f.iy = f.iz = 0;
+    if (n <= 0 || az / n < -0.99f) {
+        f.q0 = 1; f.q1 = f.q2 = f.q3 = 0;
+        return;
+    }
+    ax /= n; ay /= n; az /= n;
+    float w = 1 + az;
+    float m = sqrtf(w*w + ay*ay + ax*ax);
+    f.q0 = w / m; f.q1 = ay / m; f.q2 = -ax / m; f.q3 = 0;
+}
+
+// One Mahony step - gyro in rad/s, accelerometer in any unit, dt in s
+void mahony_update(ImuFilter& f, float gx, float gy, float gz, float ax, float ay, float az, float dt) {
+    float q0 = f.q0, q1 = f.q1, q2 = f.q2, q3 = f.q3;
+
+    float n = sqrtf(ax*ax + ay*ay + az*az);
+    if (n > 0) {
+        ax /= n; ay /= n; az /= n;
+
+        // Gravity direction predicted by the current estimate
+        float vx = 2 * (q1*q3 - q0*q2);
+        float vy = 2 * (q0*q1 + q2*q3);
+        float vz = q0*q0 - q1*q1 - q2*q2 + q3*q3;
+
+        // Error = measured x predicted
+        float ex = ay*vz - az*vy;
+        float ey = az*vx - ax*vz;
+        float ez = ax*vy - ay*vx;
+
+        f.ix += IMU_KI * ex * dt;
+        f.iy += IMU_KI * ey * dt;
+        f.iz += IMU_KI * ez * dt;
+
+        gx += IMU_KP * ex + f.ix;
+        gy += IMU_KP * ey + f.iy;
+        gz += IMU_KP * ez + f.iz;
+    }
+
+    gx *= 0.5f * dt;
+    gy *= 0.5f * dt;
+    gz *= 0.5f * dt;
+
+    f.q0 = q0 + (-q1*gx - q2*gy - q3*gz);
+    f.q1 = q1 + ( q0*gx + q2*gz - q3*gy);
+    f.q2 = q2 + ( q0*gy - q1*gz + q3*gx);
+    f.q3 = q3 + ( q0*gz + q1*gy - q2*gx);
+
+    n = sqrtf(f.q0*f.q0 + f.q1*f.q1 + f.q2*f.q2 + f.q3*f.q3);
+    f.q0 /= n; f.q1 /= n; f.q2 /= n; f.q3 /= n;
+}
+
+// PS4.attach callback - runs in the Bluetooth task once per report
+void imu_on_report() {
+    const ps4_sensor_t& s = PS4.data.sensor;
+    float ax = s.accelerometer.x / IMU_ACC_LSB_PER_G;
+    float ay = s.accelerometer.y / IMU_ACC_LSB_PER_G;
+    float az = s.accelerometer.z / IMU_ACC_LSB_PER_G;
+
+    // dt from the controller's own clock, not from Bluetooth arrival time
+    float dt = (uint16_t)(s.timestamp - imu_filter.last_stamp) * IMU_TICK_US * 1e-6f;
+    imu_filter.last_stamp = s.timestamp;
+
+    if (!imu_filter.seeded || dt <= 0 || dt > IMU_MAX_DT) {
+        mahony_seed(imu_filter, ax, ay, az);
+        imu_filter.seeded = true;
+    } else {
+        const float k = radians(1.0) / IMU_GYRO_LSB_PER_DPS;
+        mahony_update(imu_filter, s.gyroscope.x * k, s.gyroscope.y * k, s.gyroscope.z * k, ax, ay, az, dt);
+    }
+
+    const ImuFilter& f = imu_filter;
+    ImuPose pose;
+    pose.q[0] = f.q0; pose.q[1] = f.q1; pose.q[2] = f.q2; pose.q[3] = f.q3;
+    pose.vx = 2 * (f.q1*f.q3 - f.q0*f.q2);
+    pose.vy = 2 * (f.q0*f.q1 + f.q2*f.q3);
+    pose.vz = f.q0*f.q0 - f.q1*f.q1 - f.q2*f.q2 + f.q3*f.q3;
+    pose.seq = ++imu_seq;
+    pose.stamp_us = micros();
+    imu_mailbox.post(pose);
+}
+
+// Controller pitch/roll in degrees; the DualShock's gravity axis is +Y when flat
+void imu_tilt(const ImuPose& pose, float& pitch, float& roll) {
+    pitch = degrees(atan2f(pose.vz, pose.vy));
+    roll = degrees(atan2f(pose.vx, pose.vy));
+}
@@ -0,0 +1,62 @@
+// input.h
+
+#include <PS4Controller.h>
+
+// Input task - samples the controller on core 0 and hands the control task
+// one complete InputFrame through a mailbox
+
+const int INPUT_PERIOD_MS = 10;
+const uint32_t INPUT_STALE_US = 200000; // no new report for 200ms = stale
+
+struct InputFrame {
+    bool connected;
+    int8_t lx, ly, rx, ry;
+    uint32_t buttons;                   // held buttons, PS4_BUTTON_* mask
+    uint32_t stamp_ms;                  // millis() when sampled
+    uint32_t sample_us;                 // micros() when sampled
+    uint32_t seq;                       // controller report number
+    uint32_t report_us;                 // micros() when that report arrived
+};
+
+Mailbox<InputFrame> input_mailbox;      // input task -> control task
+
+// One consistent controller report per sample - no torn reads while the
+// Bluetooth task is writing
+void sample_input(InputFrame& in) {
+    ps4_snapshot_t snap;
+    bool have = PS4.snapshot(snap);
+    const ps4_t& d = snap.data;
+
+    in.connected = PS4.isConnected() && have;
+    in.lx = d.analog.stick.lx;
+    in.ly = d.analog.stick.ly;
+    in.rx = d.analog.stick.rx;
+    in.ry = d.analog.stick.ry;
+    in.buttons = d.button;
+    in.stamp_ms = millis();
+    in.sample_us = micros();
+    in.seq = snap.seq;
+    in.report_us = snap.stamp_us;
+}
+
+// Connected, but the controller has stopped sending reports
+bool input_stale(const InputFrame& in) {
+    return in.connected && (uint32_t)(micros() - in.report_us) > INPUT_STALE_US;
+}
+
+void input_task(void* arg) {
+    InputFrame in = {};
+    bool was_connected = false;
+    TickType_t wake = xTaskGetTickCount();
+
+    for (;;) {
+        sample_input(in);
+        input_mailbox.post(in);
+
+        // Connection screen is drawn by the display task, never inline
+        if (in.connected && !was_connected) display_queue.push(DISPLAY_CONNECTED);
+        was_connected = in.connected;
+
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(INPUT_PERIOD_MS));
+    }
+}
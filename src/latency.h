@@ -0,0 +1,98 @@
+// latency.h
+
+// Input-to-servo latency - every controller report that reaches the servo
+// bus is stamped at each stage:
+//   report  - Bluetooth task, report parsed (PS4Controller snapshot)
+//   sample  - input task picked it up
+//   tick    - control task started the tick that used it
+//   bus     - frame handed to the servo UART
+// Raw records go to a fixed ring, per-stage histograms are kept alongside.
+
+enum LatencyStage {
+    LAT_REPORT_TO_SAMPLE,
+    LAT_SAMPLE_TO_TICK,
+    LAT_TICK_TO_BUS,
+    LAT_END_TO_END,
+    LAT_STAGE_COUNT
+};
+
+const char* const LAT_STAGE_NAMES[LAT_STAGE_COUNT] = {
+    "report>sample", "sample>tick", "tick>bus", "report>bus"
+};
+
+const int LAT_BUCKETS = 16;                 // bucket i: [2^i, 2^(i+1)) us, last is open
+const int LAT_RING = 64;                    // power of 2
+
+struct LatencyRecord {
+    uint32_t seq;                           // controller report number
+    uint32_t report_us;
+    uint32_t sample_us;
+    uint32_t tick_us;
+    uint32_t bus_us;
+};
+
+struct LatencyHistogram {
+    uint32_t count[LAT_BUCKETS];
+    uint32_t max_us;
+    uint32_t total;
+};
+
+// Written by the control task only; the dump reads them without locking,
+// so a dump taken mid-update can be off by one sample
+LatencyRecord lat_ring[LAT_RING];
+uint32_t lat_head = 0;
+LatencyHistogram lat_hist[LAT_STAGE_COUNT];
+volatile bool lat_dump_request = false;
+
+int latency_bucket(uint32_t us) {
+    int b = 0;
+    while (us > 1 && b < LAT_BUCKETS - 1) {
+        us >>= 1;
+        b++;
+    }
+    return b;
+}
+
+void latency_add(LatencyStage stage, uint32_t us) {
+    LatencyHistogram& hist = lat_hist[stage];
+    hist.count[latency_bucket(us)]++;
+    hist.total++;
+    if (us > hist.max_us) hist.max_us = us;
+}
+
+void latency_record(const LatencyRecord& r) {
+    lat_ring[lat_head & (LAT_RING - 1)] = r;
+    lat_head++;
+
+    latency_add(LAT_REPORT_TO_SAMPLE, r.sample_us - r.report_us);
+    latency_add(LAT_SAMPLE_TO_TICK, r.tick_us - r.sample_us);
+    latency_add(LAT_TICK_TO_BUS, r.bus_us - r.tick_us);
+    latency_add(LAT_END_TO_END, r.bus_us - r.report_us);
+}
+
+void latency_reset() {
+    memset(lat_hist, 0, sizeof(lat_hist));
+    lat_head = 0;
+}
+
+// Histogram per stage, then the newest ring records
+void latency_dump(Print& out) {
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        const LatencyHistogram& hist = lat_hist[s];
+        out.printf("%s n=%lu max=%luus\n", LAT_STAGE_NAMES[s],
+            (unsigned long)hist.total, (unsigned long)hist.max_us);
+        for (int b = 0; b < LAT_BUCKETS; b++) {
+            if (hist.count[b] == 0) continue;
+            out.printf("  <%luus %lu\n", 2UL << b, (unsigned long)hist.count[b]);
+        }
+    }
+
+    uint32_t n = lat_head < LAT_RING ? lat_head : LAT_RING;
+    for (uint32_t i = lat_head - n; i != lat_head; i++) {
+        const LatencyRecord& r = lat_ring[i & (LAT_RING - 1)];
+        out.printf("#%lu %lu %lu %lu\n", (unsigned long)r.seq,
+            (unsigned long)(r.sample_us - r.report_us),
+            (unsigned long)(r.tick_us - r.sample_us),
+            (unsigned long)(r.bus_us - r.tick_us));
+    }
+}
@@ -0,0 +1,77 @@
+// log.h
+
+// Deferred logging - hot-path code pushes fixed-size binary records into a
+// lock-free ring and never touches Serial. A low-priority task on core 0
+// formats and prints them. Every site is rate limited, and whatever is
+// suppressed or dropped gets counted and reported instead.
+
+enum LogSite : uint8_t {
+    LOG_CLAMP_MIN,
+    LOG_CLAMP_MAX,
+    LOG_SITE_COUNT
+};
+
+// printf formats, three int arguments each
+const char* const LOG_FORMATS[LOG_SITE_COUNT] = {
+    "Servo %d: kąt %d° poniżej minimum (%d°) — ograniczono.",
+    "Servo %d: kąt %d° powyżej maksimum (%d°) — ograniczono.",
+};
+
+const uint32_t LOG_SITE_INTERVAL_MS = 200;  // at most 5 records/s per site
+const int LOG_PERIOD_MS = 100;
+
+struct LogRecord {
+    uint32_t stamp_ms;
+    uint8_t site;
+    uint16_t suppressed;                    // records rate-limited away before this one
+    int16_t arg[3];
+};
+
+// Producer: the control task (and setup(), before the tasks start)
+SpscQueue<LogRecord, 64> log_queue;
+uint32_t log_last_ms[LOG_SITE_COUNT];
+uint16_t log_suppressed[LOG_SITE_COUNT];
+TaskHandle_t LogHandle = NULL;
+
+void log_event(LogSite site, int a0, int a1, int a2) {
+    uint32_t now = millis();
+    if (log_last_ms[site] != 0 && now - log_last_ms[site] < LOG_SITE_INTERVAL_MS) {
+        if (log_suppressed[site] < 0xFFFF) log_suppressed[site]++;
+        return;
+    }
+
+    LogRecord r;
+    r.stamp_ms = now;
+    r.site = site;
+    r.suppressed = log_suppressed[site];
+    r.arg[0] = a0;
+    r.arg[1] = a1;
+    r.arg[2] = a2;
+
+    if (log_queue.push(r)) {
+        log_last_ms[site] = now ? now : 1;
+        log_suppressed[site] = 0;
+    }
+}
+
+void log_task(void* arg) {
+    LogRecord r;
+    uint32_t reported_drops = 0;
+
+    for (;;) {
+        while (log_queue.pop(r)) {
+            Serial.printf("[%lu] ", (unsigned long)r.stamp_ms);
+            Serial.printf(LOG_FORMATS[r.site], r.arg[0], r.arg[1], r.arg[2]);
+            if (r.suppressed) Serial.printf(" (+%u suppressed)", r.suppressed);
+            Serial.println();
+        }
+
+        uint32_t drops = log_queue.dropped;
+        if (drops != reported_drops) {
+            Serial.printf("log: %lu records dropped (ring full)\n", (unsigned long)(drops - reported_drops));
+            reported_drops = drops;
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(LOG_PERIOD_MS));
+    }
+}
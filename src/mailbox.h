@@ -0,0 +1,75 @@
+// mailbox.h
+
+#include <atomic>
+#include <stdint.h>
+
+// Lock-free single-producer / single-consumer handoff between tasks.
+// Neither side ever blocks, so a slow display or Bluetooth task can not
+// hold up a servo frame.
+
+// Latest-value mailbox (triple buffer) - the producer overwrites, the
+// consumer always gets the newest complete value.
+template <typename T>
+class Mailbox {
+public:
+    // Producer side
+    void post(const T& value) {
+        buf[back] = value;
+        back = state.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Consumer side - copies the newest value into out, returns true if it
+    // was posted since the previous take()
+    bool take(T& out) {
+        bool fresh = state.load(std::memory_order_acquire) & FRESH;
+        if (fresh) {
+            front = state.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        out = buf[front];
+        return fresh;
+    }
+
+private:
+    static const uint32_t INDEX = 0x3;
+    static const uint32_t FRESH = 0x4;
+
+    T buf[3] = {};
+    std::atomic<uint32_t> state{1};     // middle buffer index + FRESH flag
+    uint32_t back = 2;                  // owned by the producer
+    uint32_t front = 0;                 // owned by the consumer
+};
+
+// Bounded FIFO for messages that must not be coalesced. N must be a power of 2.
+template <typename T, uint32_t N>
+class SpscQueue {
+public:
+    // Producer side - returns false (and counts a drop) when full
+    bool push(const T& value) {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) >= N) {
+            dropped++;
+            return false;
+        }
+        buf[h & (N - 1)] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& out) {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        out = buf[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t dropped = 0;               // written by the producer only
+
+private:
+    static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of 2");
+
+    T buf[N];
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+};
@@ -6,8 +6,16 @@
 #include <math.h>
 #include <PS4Controller.h>
 #include "board.h" // OLED display functions
-#include "servo.h"
 #include "gait.h"
+#include "log.h"
+#include "control.h"
+#include "plan.h"
+#include "servo.h"
+#include "ik.h"
+#include "input.h"
+#include "latency.h"
+#include "telemetry.h"
+#include "imu.h"
 
 // Pin Definitions
 #define S_RXD 18
@@ -21,163 +29,272 @@
 
 // Gait control
 GaitMode gait = CREEP_FORWARD;
+bool was_connected = false;
+uint32_t last_latency_seq = 0;
 
-// Button states
-bool last_circle = false;
-bool last_triangle = false;
-bool last_cross = false;
-bool last_up = false;
-bool last_down = false;
-bool last_left = false;
-bool last_right = false;
+// Controller tilt reference, captured when L1 is pressed
+bool tilt_ref_set = false;
+float tilt_ref_pitch = 0;
+float tilt_ref_roll = 0;
 
-// Gait parameters
+// What drives the legs - a change crossfades to the new pose
+enum PoseSource { POSE_NEUTRAL, POSE_GAIT, POSE_STICK_TILT, POSE_IMU_TILT };
+PoseSource pose_source = POSE_NEUTRAL;
 
-void calculate_gait_angles(GaitMode mode, float phase, float angles[4][2]) {
-    const GaitParams& params = GAIT_CONFIGS[mode];
-    const char* legs[4] = {"lf", "rf", "lr", "rr"};
-    
-    // Dynamic z_offsets based on current h value
-    float dynamic_z_offsets[4] = {90-h, 90+h, 90+h, 90-h};
-    
-    for (int i = 0; i < 4; i++) {
-        float current_phase = fmod(phase + params.phase_offsets[i], 1.0f);
-        creep_gait(params.x_amps[i], params.z_amps[i], params.x_offsets[i], 
-                dynamic_z_offsets[i], current_phase, angles[i][1], angles[i][0]);
-    }
+void set_pose_source(PoseSource source) {
+    if (source == pose_source) return;
+    pose_source = source;
+    transition_start();
 }
 
-void execute_gait(GaitMode mode) {
-    unsigned long current_time = millis();
-    if (current_time - last_gait_time < GAIT_DT) return;
-    last_gait_time = current_time;
-    gait_phase = fmod(gait_phase + (GAIT_DT / 1000.0) / t_cycle, 1.0);
-    float angles[4][2]; // [leg_index][0=x, 1=z]
+// Gait parameters
+
+void execute_gait(uint32_t elapsed_us) {
+    gait_slew(gait_cmd, gait_target, elapsed_us);
+    uint16_t prev_phase = gait_phase;
+    gait_phase += phase_advance(elapsed_us);
+    if (gait_style_update(prev_phase, gait_phase)) transition_start();
 
-    calculate_gait_angles(mode, gait_phase, angles);
-    // const int leg_to_index[4] = {0, 1, 2, 3}; // lf, rf, lr, rr // do usunięcia ta linijka
-    
-    for (int i = 0; i < 8; i++) {
+    // Presets are re-mixed every tick, so the command can change mid-stride
+    GaitBlend blend = gait_blend(gait_cmd, gait_style);
+    gait = gait_dominant(blend);
+
+    int angles[4][2]; // [leg_index][0=x, 1=z]
+    if (gait_foot_space) {
+        calculate_gait_angles_ik(blend, gait_phase, h, angles);
+    } else {
+        calculate_gait_angles(blend, gait_phase, h, angles);
+    }
+
+    // Clamps are logged here too: log_event() is rate-limited and lock-free
+    for (int i = 0; i < SERVO_COUNT; i++) {
         const ServoMapping& mapping = SERVO_MAPPING[i];
-        int leg_index = -1;
-        
-        if (strcmp(mapping.leg, "lf") == 0) leg_index = 0;
-        else if (strcmp(mapping.leg, "rf") == 0) leg_index = 1;
-        else if (strcmp(mapping.leg, "lr") == 0) leg_index = 2;
-        else if (strcmp(mapping.leg, "rr") == 0) leg_index = 3;
-        
-        if (leg_index != -1) {
-            float angle = 0;
-            if (strcmp(mapping.axis, "x") == 0) {
-                angle = angles[leg_index][0];
-            } else if (strcmp(mapping.axis, "z") == 0) {
-                angle = angles[leg_index][1];
-            }
-            move_servo(mapping.servo_id, (int)angle);
-        }
+        stage_servo_count(mapping.servo_id, servo_target(mapping.servo_id, angles[mapping.leg][mapping.axis], true));
     }
+    commit_frame();
 }
 
 void return_to_neutral() {
-    move_servo(1, 45);     // servo 1
-    move_servo(2, 90 - h);  // servo 2
-    move_servo(3, 135);      // servo 3
-    move_servo(4, 90 + h);  // servo 4
-    move_servo(5, 135);      // servo 5
-    move_servo(6, 90 + h);  // servo 6
-    move_servo(7, 45);     // servo 7
-    move_servo(8, 90 - h);  // servo 8
+    stage_servo(1, 45);     // servo 1
+    stage_servo(2, 90 - h);  // servo 2
+    stage_servo(3, 135);      // servo 3
+    stage_servo(4, 90 + h);  // servo 4
+    stage_servo(5, 135);      // servo 5
+    stage_servo(6, 90 + h);  // servo 6
+    stage_servo(7, 45);     // servo 7
+    stage_servo(8, 90 - h);  // servo 8
+    commit_frame();
     
     running = false;
 }
 
-void process_PS4_input() {
-    // Read and normalize stick values with deadzone
-    float lx = (abs(PS4.LStickX()) < DEADZONE * 128) ? 0 : PS4.LStickX() / 128.0;
-    float ly = (abs(PS4.LStickY()) < DEADZONE * 128) ? 0 : PS4.LStickY() / 128.0;    
-    float rx = (abs(PS4.RStickX()) < DEADZONE * 128) ? 0 : PS4.RStickX() / 128.0;
-    float ry = (abs(PS4.RStickY()) < DEADZONE * 128) ? 0 : PS4.RStickY() / 128.0;
+// Body tilt from normalized -1..1 inputs (right stick or controller tilt)
+void body_tilt(float rx, float ry) {
+    int baseAngle2 = 90 - h;  // Front-left
+    int baseAngle4 = 90 + h;  // Front-right  
+    int baseAngle6 = 90 + h;  // Rear-left
+    int baseAngle8 = 90 - h;  // Rear-right
+    
+    // Calculate tilt offsets - jedna strona w górę, druga w dół
+    int frontTilt = -ry * maxDeviation;  // UP: front down (-), DOWN: front up (+)
+    int rearTilt = ry * maxDeviation;    // UP: rear up (+), DOWN: rear down (-)
+    int leftTilt = -rx * maxDeviation;   // LEFT: left down (-), RIGHT: left up (+)
+    int rightTilt = rx * maxDeviation;   // LEFT: right up (+), RIGHT: right down (-)
+    
+    // Apply combined offsets - przeciwne ruchy dla przeciwległych nóg
+    stage_servo_smooth(2, (baseAngle2 + frontTilt + leftTilt));  // Front-left
+    stage_servo_smooth(4, (baseAngle4 - frontTilt - rightTilt)); // Front-right
+    stage_servo_smooth(6, (baseAngle6 - rearTilt - leftTilt));   // Rear-left  
+    stage_servo_smooth(8, (baseAngle8 + rearTilt + rightTilt));  // Rear-right
+    commit_frame();
+}
+
+void process_PS4_input(const InputFrame& in, const ImuPose& pose) {
+    if (!(in.buttons & PS4_BUTTON_L1)) tilt_ref_set = false;
+
+    // Normalize stick values with deadzone
+    float lx = (abs(in.lx) < DEADZONE * 128) ? 0 : in.lx / 128.0;
+    float ly = (abs(in.ly) < DEADZONE * 128) ? 0 : in.ly / 128.0;    
+    float rx = (abs(in.rx) < DEADZONE * 128) ? 0 : in.rx / 128.0;
+    float ry = (abs(in.ry) < DEADZONE * 128) ? 0 : in.ry / 128.0;
 
     bool leftStickActive = (abs(lx) > DEADZONE || abs(ly) > DEADZONE);
     bool rightStickActive = (abs(rx) > DEADZONE || abs(ry) > DEADZONE);
 
-    // Process left stick - movement
+    // Process left stick - movement. Forward/back and turn from the left
+    // stick, strafe from the right stick's x while walking
     if (leftStickActive) {
-        running = true;
-        if (ly > 0.5) { 
-            gait = CREEP_FORWARD; 
-        } else if (ly < -0.5) { 
-            gait = CREEP_BACKWARD; 
-        } else if (lx > 0.5) { 
-            gait = CREEP_RIGHT; 
-        } else if (lx < -0.5) { 
-            gait = CREEP_LEFT; 
+        if (!running) {
+            gait_cmd = GaitCommand{0, 0, 0};    // ramp up from standstill
+            gait_style = gait_style_next;
         }
+        running = true;
+        set_pose_source(POSE_GAIT);
+        gait_target.vx = ly;
+        gait_target.vy = -rx;
+        gait_target.wz = -lx;
     } 
 
+    // L1 held - controller tilt drives body tilt, relative to the
+    // controller pose when L1 went down
+    else if ((in.buttons & PS4_BUTTON_L1) && pose.seq != 0) {
+        running = false;
+        gait_phase = 0;
+        set_pose_source(POSE_IMU_TILT);
+
+        float pitch, roll;
+        imu_tilt(pose, pitch, roll);
+        if (!tilt_ref_set) {
+            tilt_ref_pitch = pitch;
+            tilt_ref_roll = roll;
+            tilt_ref_set = true;
+        }
+        float tx = constrain((roll - tilt_ref_roll) / IMU_TILT_FULL_DEG, -1.0f, 1.0f);
+        float ty = constrain((pitch - tilt_ref_pitch) / IMU_TILT_FULL_DEG, -1.0f, 1.0f);
+        body_tilt(tx, ty);
+    }
+
     // Process right stick - height and tilt adjustment
     else if (rightStickActive) {
         running = false;  // Stop gait gdy używamy prawej gałki
-        gait_phase = 0.0;
+        gait_phase = 0;
+        set_pose_source(POSE_STICK_TILT);
 
-        int baseAngle2 = 90 - h;  // Front-left
-        int baseAngle4 = 90 + h;  // Front-right  
-        int baseAngle6 = 90 + h;  // Rear-left
-        int baseAngle8 = 90 - h;  // Rear-right
-        
-        // Calculate tilt offsets - jedna strona w górę, druga w dół
-        int frontTilt = -ry * maxDeviation;  // UP: front down (-), DOWN: front up (+)
-        int rearTilt = ry * maxDeviation;    // UP: rear up (+), DOWN: rear down (-)
-        int leftTilt = -rx * maxDeviation;   // LEFT: left down (-), RIGHT: left up (+)
-        int rightTilt = rx * maxDeviation;   // LEFT: right up (+), RIGHT: right down (-)
-        
-        // Apply combined offsets - przeciwne ruchy dla przeciwległych nóg
-        move_servo_smooth(2, (baseAngle2 + frontTilt + leftTilt));  // Front-left
-        move_servo_smooth(4, (baseAngle4 - frontTilt - rightTilt)); // Front-right
-        move_servo_smooth(6, (baseAngle6 - rearTilt - leftTilt));   // Rear-left  
-        move_servo_smooth(8, (baseAngle8 + rearTilt + rightTilt));  // Rear-right
-        
+        body_tilt(rx, ry);
     }  else {
         running = false;
-        gait_phase = 0.0;
+        gait_phase = 0;
+        set_pose_source(POSE_NEUTRAL);
         return_to_neutral();
     }
 }
 
-void processButtons() {
-    if (PS4.Up() && !last_up) {h += 5; return_to_neutral();}
-    if (PS4.Down() && !last_down) {h -= 5; return_to_neutral();}
+// Button presses - down edges from the controller's event queue
+void processButtons(uint32_t pressed) {
+    // Height changes ease in on the next frames, whatever pose is running
+    if (pressed & PS4_BUTTON_UP) {h += 5; transition_start();}
+    if (pressed & PS4_BUTTON_DOWN) {h -= 5; transition_start();}
     if (h < 0) h = 0;
     if (h > 50) h = 50;
 
-    if (PS4.Left() && !last_left) {t_cycle -= 1;}
-    if (PS4.Right() && !last_right) {t_cycle += 1;}
+    if (pressed & PS4_BUTTON_LEFT) {t_cycle -= 1;}
+    if (pressed & PS4_BUTTON_RIGHT) {t_cycle += 1;}
     if (t_cycle < 1.5) t_cycle = 1.5;
     if (t_cycle > 4.5) t_cycle = 4.5;
 
-    last_up = PS4.Up();
-    last_down = PS4.Down();
-    last_left = PS4.Left();
-    last_right = PS4.Right();
+    // Gait style - switched at the next half cycle while walking
+    if (pressed & PS4_BUTTON_CROSS) gait_select(GAIT_CREEP);
+    if (pressed & PS4_BUTTON_CIRCLE) gait_select(GAIT_TROT);
+    if (pressed & PS4_BUTTON_TRIANGLE) {gait_foot_space = !gait_foot_space; transition_start();}
+
+    if (pressed & PS4_BUTTON_SHARE) lat_dump_request = true;
 }
 
 void onConnect() {
-    ConnectedText();
+    // The connected screen is drawn by the display task
     Serial.println("PS4 controller connected");
 }
 
 void onDisconnect() {
+    // The control task sees the disconnect and returns to neutral itself,
+    // so the servo bus is only ever driven from one task
     Serial.println("PS4 controller disconnected");
-    return_to_neutral();
+}
+
+// One control tick, run by the control task (control.h)
+void control_tick(uint32_t elapsed_us) {
+    uint32_t tick_us = micros();
+    uint32_t commit_before = frame_commit_us;
+    InputFrame in;
+    input_mailbox.take(in);
+
+    // A stalled report stream is handled like a disconnect
+    bool active = in.connected && !input_stale(in);
+
+    // Bulk feedback only while someone is listening, at the telemetry rate
+    bool feedback_due = telemetry_active && control_stats.ticks % telemetry_feedback_every() == 0;
+    if (feedback_due) hold_for_feedback();
+
+    // Every press since the last tick, even ones already released
+    ps4_button_event_t event;
+    while (PS4.nextButtonEvent(event)) {
+        if (active) processButtons(event.down);
+    }
+
+    if (active) {
+        was_connected = true;
+        ImuPose pose;
+        imu_mailbox.take(pose);
+        process_PS4_input(in, pose);
+        
+        // Tylko gait (automatyczny chód) - gdy lewa gałka aktywna
+        if (running) {
+            execute_gait(elapsed_us);
+        }
+
+        // First frame sent after a new report closes its latency record
+        if (in.seq != last_latency_seq && frame_commit_us != commit_before) {
+            last_latency_seq = in.seq;
+            LatencyRecord r = {in.seq, in.report_us, in.sample_us, tick_us, frame_commit_us};
+            latency_record(r);
+        }
+    } else if (was_connected || transition_active()) {
+        // Kontroler rozłączony - zatrzymaj wszystko, then keep committing
+        // neutral until the crossfade into it has finished
+        if (was_connected) {
+            was_connected = false;
+            running = false;
+            gait_phase = 0;
+            set_pose_source(POSE_NEUTRAL);
+        }
+        return_to_neutral();
+    }
+
+    static TelemetryFrame t;
+    t.stamp_ms = millis();
+    t.gait = gait;
+    t.running = running;
+    t.phase = gait_phase;
+    t.h = h;
+    t.t_cycle = t_cycle;
+    memcpy(t.commanded, servo_commanded, sizeof(t.commanded));
+    t.control = control_stats;
+
+    if (feedback_due) {
+        read_servo_feedback();
+        t.feedback_ok = 0;
+        for (int i = 0; i < servo_feedback.IDN; i++) {
+            int idx = servo_feedback.ID[i] - 1;
+            if (!servo_feedback.Ok[i] || idx < 0 || idx >= SERVO_COUNT) continue;
+            t.feedback_ok |= 1 << idx;
+            t.servo[idx].pos = servo_feedback.Pos[i];
+            t.servo[idx].load = servo_feedback.Load[i];
+            t.servo[idx].current = servo_feedback.Current[i];
+            t.servo[idx].temperature = servo_feedback.Temper[i];
+            t.servo[idx].voltage = servo_feedback.Voltage[i];
+        }
+        t.feedback_ms = t.stamp_ms;
+    } else if (t.feedback_ok && t.stamp_ms - t.feedback_ms > feedback_stale_ms()) {
+        // Reads stopped (no listener, rate change): don't keep reporting the
+        // last values as live
+        t.feedback_ok = 0;
+    }
+    telemetry_mailbox.post(t);
 }
 
 void setup() {
     Serial.begin(115200);
-    Serial1.begin(1000000, SERIAL_8N1, S_RXD, S_TXD);
-    st.pSerial = &Serial1;
+    // Servo bus on the IDF UART driver: frame writes return as soon as
+    // they are queued, so the next gait frame is computed while they drain
+    if (!st.begin(UART_NUM_1, 1000000, S_RXD, S_TXD)) {
+        Serial.println("UART driver install failed, falling back to Serial1");
+        Serial1.begin(1000000, SERIAL_8N1, S_RXD, S_TXD);
+        st.pSerial = &Serial1;
+    }
     
     PS4.attachOnConnect(onConnect);
     PS4.attachOnDisconnect(onDisconnect);
+    PS4.attach(imu_on_report);
     PS4.begin(); 
     delay(1000);
     
@@ -187,28 +304,23 @@ void setup() {
     scanServos();
     displayResultsScreen();
 
+    bake_gait_shapes();
     return_to_neutral();
 
+    // Input, display and telemetry on core 0; control on core 1
+    xTaskCreatePinnedToCore(input_task, "input", 4096, NULL, 3, &ClientCmdHandle, IO_CORE);
+    xTaskCreatePinnedToCore(display_task, "display", 4096, NULL, 1, &ScreenUpdateHandle, IO_CORE);
+    xTaskCreatePinnedToCore(telemetry_task, "telemetry", 4096, NULL, 1, &TelemetryHandle, IO_CORE);
+    xTaskCreatePinnedToCore(log_task, "log", 3072, NULL, 1, &LogHandle, IO_CORE);
+
+    if (!control_begin(control_tick, CONTROL_HZ)) {
+        Serial.println("Control task start failed");
+    }
+
     Serial.println("Inicjalizacja zakończona");
 }
 
 void loop() {
-    if (PS4.isConnected()) {
-        process_PS4_input();
-        processButtons();
-        
-        // Tylko gait (automatyczny chód) - gdy lewa gałka aktywna
-        if (running) {
-            execute_gait(gait);
-        }
-    } else {
-        // Kontroler rozłączony - zatrzymaj wszystko
-        if (running) {
-            running = false;
-            gait_phase = 0.0;
-            return_to_neutral();
-        }
-    }
-    
+    // Servo control runs in the control task - nothing to do here
     delay(20);
-}
\ No newline at end of file
+}
@@ -0,0 +1,138 @@
+// plan.h
+
+// Segment planning for the servos' own motion profile. Sent a goal, a speed
+// and an acceleration, an SMS_STS servo speeds up (or slows down) to the
+// speed, cruises and brakes at the same rate to stop on the goal. Positions
+// are not read back, so the planner keeps a model of every servo - where it
+// should be and how fast it moves - and advances it along the profile each
+// servo was last sent. Units are servo steps and seconds.
+
+#include <math.h>
+
+const float PLAN_RAMP = 0.25;               // share of a segment for each speed change
+const int PLAN_SPEED_MIN = 1;               // steps/s - 0 would mean full speed
+const int PLAN_ACC_MAX = 254;               // x100 steps/s^2, register limit
+const float PLAN_ACC_LIMIT = PLAN_ACC_MAX * 100.0f;
+const float PLAN_SPEED_FULL = 3400;         // steps/s, what speed 0 runs at
+const float PLAN_ACC_FULL = 1e6;            // steps/s^2, acc 0 - no ramp at all
+const int PLAN_MODEL_STEPS = 10;            // integration steps per advance
+const float PLAN_SETTLED = 0.5;             // steps, the model counts as on target
+
+struct ServoModel {
+    float pos;                              // steps
+    float vel;                              // steps/s, signed
+    float goal;
+    float speed;                            // profile being run
+    float acc;
+};
+
+void model_reset(ServoModel& m, float pos) {
+    m.pos = m.goal = pos;
+    m.vel = 0;
+    m.speed = PLAN_SPEED_FULL;
+    m.acc = PLAN_ACC_FULL;
+}
+
+// New goal with its speed and acc register values
+void model_start(ServoModel& m, float goal, int speed, int acc) {
+    m.goal = goal;
+    m.speed = speed ? speed : PLAN_SPEED_FULL;
+    m.acc = acc ? acc * 100.0f : PLAN_ACC_FULL;
+}
+
+// What the servo does for dt: the fastest speed towards the goal that still
+// lets it stop there, capped at the profile speed, reached at the profile
+// acceleration
+void model_advance(ServoModel& m, float dt) {
+    float h = dt / PLAN_MODEL_STEPS;
+    for (int k = 0; k < PLAN_MODEL_STEPS; k++) {
+        float d = m.goal - m.pos;
+        float v = fminf(m.speed, sqrtf(2 * m.acc * fabsf(d)));
+        float dv = (d < 0 ? -v : v) - m.vel;
+        float dv_max = m.acc * h;
+        m.vel += dv > dv_max ? dv_max : (dv < -dv_max ? -dv_max : dv);
+        m.pos += m.vel * h;
+    }
+}
+
+// Shortest time in which a servo moving at u0 towards a goal d away (u0 < 0:
+// away from it) can stop on it, at acceleration a and speed v_max. A servo
+// too fast to stop in d overshoots whatever it is sent; it is counted from
+// the fastest speed that still stops.
+float plan_min_time(float d, float u0, float a, float v_max) {
+    float u_stop = sqrtf(2 * a * d);
+    if (u0 > u_stop) u0 = u_stop;
+    float v_peak = sqrtf(u0 * u0 / 2 + a * d);
+    if (v_peak <= v_max) return (2 * v_peak - u0) / a;
+    // Cruises at v_max in between
+    float ramps = (2 * v_max * v_max - u0 * u0) / (2 * a);
+    return (2 * v_max - u0) / a + (d - ramps) / v_max;
+}
+
+// Cruise speed that covers d in t from u0 and stops there, at acceleration
+// a: speeding up, (v^2 + (v - u0)^2) / 2a of the distance goes to ramps,
+// slowing down (2 v u0 - u0^2) / 2a
+float plan_cruise(float d, float u0, float t, float a) {
+    float b = u0 + a * t;
+    float disc = b * b - 2 * u0 * u0 - 4 * a * d;
+    float v = (b - sqrtf(disc > 0 ? disc : 0)) / 2;
+    if (v >= u0) return v;
+    float rest = t - u0 / a;
+    float dv = d - u0 * u0 / (2 * a);
+    if (dv > 0 && rest > 0) return dv / rest;
+    // Too fast to stop in d: it overshoots by -dv and comes back from rest
+    // in whatever the segment has left
+    if (rest <= 0) return sqrtf(-dv * a);
+    return plan_cruise(-dv, 0, rest, a);
+}
+
+struct PlanProfile {
+    float v;                                // cruise speed, steps/s
+    float a;                                // steps/s^2
+};
+
+// Cruise speed and acceleration that cover d in t from u0 and stop there,
+// the speed change taking the first PLAN_RAMP of the segment and the brake
+// at most the last - from rest that cruises at d / (t (1-r)). Where those
+// ramps would need more than the register allows they run at PLAN_ACC_LIMIT
+// and take longer. t must be at least plan_min_time() at PLAN_ACC_LIMIT.
+PlanProfile plan_profile(float d, float u0, float t) {
+    const float r = PLAN_RAMP;
+    PlanProfile p;
+    p.v = d / (t * (1 - r));
+    // The ramps depend on the cruise speed and it on them; a few rounds
+    // settle well inside a step/s
+    for (int k = 0; k < 4; k++) {
+        p.a = fmaxf(p.v, fabsf(p.v - u0)) / (r * t);
+        if (p.a > PLAN_ACC_LIMIT) p.a = PLAN_ACC_LIMIT;
+        p.v = plan_cruise(d, u0, t, p.a);
+    }
+    return p;
+}
+
+// One frame: a segment of at least t for n servos, d[i] steps from their
+// goals and moving towards them at u0[i]. A segment that is too short for
+// the speed limit or for the acceleration limit of any servo stretches for
+// all of them, so they still arrive together. Returns the segment time.
+//
+// A servo the model already has on its goal (a refresh of an unchanged
+// target) has nothing to plan; it is sent speed_max at PLAN_ACC_LIMIT, so
+// an error the model cannot see - a lost frame, lag under load - is closed
+// at full speed rather than at the 1 step/s floor.
+float plan_segment(int n, const float d[], const float u0[], float t, float speed_max, PlanProfile out[]) {
+    for (int i = 0; i < n; i++) {
+        float t_speed = d[i] / (speed_max * (1 - PLAN_RAMP));
+        float t_acc = plan_min_time(d[i], u0[i], PLAN_ACC_LIMIT, speed_max);
+        if (t_speed > t) t = t_speed;
+        if (t_acc > t) t = t_acc;
+    }
+    for (int i = 0; i < n; i++) {
+        if (d[i] < PLAN_SETTLED) {
+            out[i].v = speed_max;
+            out[i].a = PLAN_ACC_LIMIT;
+        } else {
+            out[i] = plan_profile(d[i], u0[i], t);
+        }
+    }
+    return t;
+}
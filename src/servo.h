@@ -13,19 +13,6 @@ const int speed = 2400;
 
 const float DEADZONE = 0.2;
 
-const int SERVO_TRIMS[8] = {-25, 15, 30, 0, -15, 0, -10, 45};
-
-const int SERVO_LIMITS[8][2] = {
-    {0, 90},                // servo 1
-    {30, 140},              // servo 2
-    {90, 180},              // servo 3
-    {40, 150},              // servo 4
-    {90, 180},              // servo 5
-    {40, 150},              // servo 6
-    {0, 90},                // servo 7
-    {30, 140}               // servo 8
-};    
-
 int angle_deg_to_servo(float deg) {
     float rad = radians(deg);  // ° → rad
     int center = 2048;
@@ -33,32 +20,198 @@ int angle_deg_to_servo(float deg) {
     return 4095 - (int)round(rad * scale + center);
 }
 
+// Silent clamp to the servo's mechanical range
+int clamp_angle(int id, int angle_deg) {
+    if (id < 1 || id > SERVO_COUNT) return angle_deg;
+    if (angle_deg < SERVO_MAPPING[id-1].min_angle) return SERVO_MAPPING[id-1].min_angle;
+    if (angle_deg > SERVO_MAPPING[id-1].max_angle) return SERVO_MAPPING[id-1].max_angle;
+    return angle_deg;
+}
+
 int check_angle_limit(int id, int angle_deg) {
-    if (id < 1 || id > 8) return angle_deg;
+    if (id < 1 || id > SERVO_COUNT) return angle_deg;
     
-    int min_angle = SERVO_LIMITS[id-1][0];
-    int max_angle = SERVO_LIMITS[id-1][1];
+    int min_angle = SERVO_MAPPING[id-1].min_angle;
+    int max_angle = SERVO_MAPPING[id-1].max_angle;
     
     if (angle_deg < min_angle) {
-        Serial.printf("Servo %d: kąt %d° poniżej minimum (%d°) — ograniczono.\n", id, angle_deg, min_angle);
+        log_event(LOG_CLAMP_MIN, id, angle_deg, min_angle);
         angle_deg = min_angle;
     } else if (angle_deg > max_angle) {
-        Serial.printf("Servo %d: kąt %d° powyżej maksimum (%d°) — ograniczono.\n", id, angle_deg, max_angle);
+        log_event(LOG_CLAMP_MAX, id, angle_deg, max_angle);
         angle_deg = max_angle;
     }
     return angle_deg;
 }
 
-void move_servo(int id, int angle_deg) {
-    int safe_angle = check_angle_limit(id, angle_deg);
+// Trimmed, limit-checked position in servo counts
+int servo_target(int id, int angle_deg, bool report = true) {
+    int safe_angle = report ? check_angle_limit(id, angle_deg) : clamp_angle(id, angle_deg);
     int pos = angle_deg_to_servo(safe_angle);
-    int trimmed_pos = pos + SERVO_TRIMS[id-1];
-    st.WritePosEx(id, trimmed_pos, speed, acc);
+    return pos + SERVO_MAPPING[id-1].trim;
 }
 
-void move_servo_smooth(int id, int angle_deg) {
-    int safe_angle = check_angle_limit(id, angle_deg);
-    int pos = angle_deg_to_servo(safe_angle);
-    int trimmed_pos = pos + SERVO_TRIMS[id-1];
-    st.WritePosEx(id, trimmed_pos, 500, 50);
+// Frame commit - targets are staged during a tick and sent together
+// as one SyncWritePosEx broadcast (no ack). The staged speed and acc are
+// only used with motion_plan off; otherwise plan_frame() sets them.
+u8 frame_ids[SERVO_COUNT];
+s16 frame_pos[SERVO_COUNT];
+u16 frame_speed[SERVO_COUNT];
+u8 frame_acc[SERVO_COUNT];
+int frame_count = 0;
+uint32_t frame_commit_us = 0;               // micros() when the last frame was queued
+s16 servo_commanded[SERVO_COUNT];           // last position sent, by servo_id - 1
+
+// Stage a position already in servo counts (trimmed and clamped)
+void stage_servo_count(int id, s16 pos, u16 servo_speed = speed, u8 servo_acc = acc) {
+    if (id < 1 || id > SERVO_COUNT) return;
+
+    // Staging the same servo twice in one frame overwrites its target
+    int slot = 0;
+    while (slot < frame_count && frame_ids[slot] != id) slot++;
+    if (slot == frame_count) frame_count++;
+
+    frame_ids[slot] = id;
+    frame_pos[slot] = pos;
+    frame_speed[slot] = servo_speed;
+    frame_acc[slot] = servo_acc;
+}
+
+void stage_servo(int id, int angle_deg, u16 servo_speed = speed, u8 servo_acc = acc) {
+    if (id < 1 || id > SERVO_COUNT) return;
+    stage_servo_count(id, servo_target(id, angle_deg), servo_speed, servo_acc);
+}
+
+void stage_servo_smooth(int id, int angle_deg) {
+    stage_servo(id, angle_deg, 500, 50);
+}
+
+// Pose crossfade - after transition_start() each committed frame is eased
+// from the pose commanded at that moment towards whatever was staged, on a
+// minimum-jerk profile, so switching between gait, tilt and neutral never
+// steps the servos even while the target itself keeps moving
+int transition_ticks = 30;                  // frames per crossfade, one per control tick
+int transition_frame = -1;                  // -1 = no crossfade running
+s16 transition_from[SERVO_COUNT];
+bool servo_commanded_valid = false;
+
+void transition_start() {
+    if (!servo_commanded_valid || transition_ticks <= 0) return;
+    memcpy(transition_from, servo_commanded, sizeof(transition_from));
+    transition_frame = 0;
+}
+
+bool transition_active() {
+    return transition_frame >= 0;
+}
+
+// 10t^3 - 15t^4 + 6t^5 in Q15 - zero velocity and acceleration at both ends
+int32_t min_jerk_q15(int frame, int frames) {
+    float t = (float)frame / frames;
+    return (int32_t)(t * t * t * (10 + t * (-15 + 6 * t)) * 32768 + 0.5f);
+}
+
+void transition_apply() {
+    int32_t k = min_jerk_q15(++transition_frame, transition_ticks);
+    for (int i = 0; i < frame_count; i++) {
+        s16 from = transition_from[frame_ids[i] - 1];
+        frame_pos[i] = from + (((frame_pos[i] - from) * k + (1 << 14)) >> 15);
+    }
+    if (transition_frame >= transition_ticks) transition_frame = -1;
+}
+
+// Motion planning - each frame is one segment of the commanded trajectory,
+// due at the next tick boundary. plan.h turns each servo's distance to its
+// target and its speed, both from plan_model, into a profile the servo can
+// run at the register's acceleration; a segment that does not fit stretches
+// for all servos, so they still arrive together without reading positions
+// back. Servos whose target did not change are left out of the frame, with
+// a full frame every PLAN_REFRESH.
+bool motion_plan = true;
+const int PLAN_REFRESH = 50;                // frames between full frames, for lost broadcasts
+
+ServoModel plan_model[SERVO_COUNT];         // by servo_id - 1, follows what was sent
+uint32_t plan_model_us = 0;                 // micros() the models were advanced to
+int plan_frames = 0;
+
+void plan_frame() {
+    float t = (control_period_us ? control_period_us : 1000000 / CONTROL_HZ) * 1e-6f;
+    bool refresh = ++plan_frames >= PLAN_REFRESH;
+    if (refresh) plan_frames = 0;
+
+    int n = 0;
+    float d[SERVO_COUNT], u0[SERVO_COUNT];
+    for (int i = 0; i < frame_count; i++) {
+        int idx = frame_ids[i] - 1;
+        if (frame_pos[i] == servo_commanded[idx] && !refresh) continue;   // settles on the target it has
+
+        const ServoModel& m = plan_model[idx];
+        float dd = frame_pos[i] - m.pos;
+        d[n] = fabsf(dd);
+        u0[n] = dd < 0 ? -m.vel : m.vel;
+        frame_ids[n] = frame_ids[i];
+        frame_pos[n] = frame_pos[i];
+        n++;
+    }
+    frame_count = n;
+
+    PlanProfile prof[SERVO_COUNT];
+    plan_segment(n, d, u0, t, speed, prof);
+    for (int i = 0; i < n; i++) {
+        long v = lroundf(prof[i].v);
+        int acc_units = (int)ceilf(prof[i].a / 100);
+        frame_speed[i] = v < PLAN_SPEED_MIN ? PLAN_SPEED_MIN : (v > speed ? speed : (u16)v);
+        frame_acc[i] = acc_units < 1 ? 1 : (acc_units > PLAN_ACC_MAX ? PLAN_ACC_MAX : acc_units);
+    }
+}
+
+void commit_frame() {
+    if (frame_count == 0) return;
+    if (transition_active()) transition_apply();
+    if (!servo_commanded_valid) {
+        for (int i = 0; i < frame_count; i++) model_reset(plan_model[frame_ids[i] - 1], frame_pos[i]);
+        plan_model_us = micros();
+    } else {
+        // Where the servos got to since the last tick, stalls included
+        uint32_t period = control_period_us ? control_period_us : 1000000 / CONTROL_HZ;
+        uint32_t now = micros();
+        uint32_t elapsed = now - plan_model_us;
+        plan_model_us = now;
+        if (elapsed > CONTROL_MAX_LAG * period) elapsed = CONTROL_MAX_LAG * period;
+        for (int i = 0; i < SERVO_COUNT; i++) model_advance(plan_model[i], elapsed * 1e-6f);
+        if (motion_plan) plan_frame();
+    }
+    if (frame_count == 0) return;
+
+    for (int i = 0; i < frame_count; i++) {
+        servo_commanded[frame_ids[i] - 1] = frame_pos[i];
+        model_start(plan_model[frame_ids[i] - 1], frame_pos[i], frame_speed[i], frame_acc[i]);
+    }
+    servo_commanded_valid = true;
+    st.SyncWritePosEx(frame_ids, frame_count, frame_pos, frame_speed, frame_acc);
+    frame_count = 0;
+    frame_commit_us = micros();
+}
+
+// Bulk feedback - one sync read returns position, speed, load, voltage,
+// temperature, moving flag and current for all eight servos. On feedback
+// ticks the bus scheduler holds the tick's position frame and sends it and
+// the sync read in one write
+u8 feedback_ids[SERVO_COUNT] = {1, 2, 3, 4, 5, 6, 7, 8};
+SMS_STS_FeedBack servo_feedback;
+SCSBus servo_bus(&st);
+u8 feedback_raw[SERVO_COUNT * SMS_STS_FEEDBACK_LEN];
+u8 feedback_rx_ok[SERVO_COUNT];
+
+// Call before the tick's commit_frame()
+void hold_for_feedback() {
+    servo_bus.hold();
+}
+
+// Sends the held frame with the sync read behind it and waits for the replies
+int read_servo_feedback() {
+    servo_bus.syncRead(feedback_ids, SERVO_COUNT, SMS_STS_PRESENT_POSITION_L,
+                       SMS_STS_FEEDBACK_LEN, feedback_raw, feedback_rx_ok);
+    servo_bus.run();
+    return st.FeedBackDecode(feedback_ids, SERVO_COUNT, feedback_raw, feedback_rx_ok, &servo_feedback);
 }
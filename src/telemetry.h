@@ -0,0 +1,187 @@
+// telemetry.h
+
+// Binary telemetry over SerialBT. The control task posts a TelemetryFrame
+// every tick (with bulk servo feedback every few ticks); this task on core 0
+// samples it at telemetry_hz, packs each sample into a versioned record,
+// COBS-frames it and sends several frames per SerialBT write so the SPP
+// stream stays out of the way of the PS4 L2CAP link. It also prints the
+// latency dump (latency.h) to Serial when one is requested.
+//
+// Wire format, one frame per record:
+//   COBS(payload + crc16) 0x00
+// payload (little endian), version 2:
+//   u8 version, u8 type, u16 seq, u32 stamp_ms
+//   type 1 (state):
+//     u8 gait, u8 flags (bit0 running, bit1 feedback valid), u16 phase (Q16),
+//     u8 h, u8 t_cycle*10,
+//     s16 commanded[8]                       servo counts
+//     u32 ticks, u32 overruns, u32 missed,
+//     u16 jitter_avg_us, u16 jitter_max_us, u16 exec_max_us
+//     u8 feedback_ok_mask, u16 feedback_age_ms, then per servo:
+//       s16 pos, s16 load, s16 current, u8 temperature, u8 voltage
+// crc16 is CCITT-FALSE over the payload. Decoder: tools/telemetry_decode.py
+
+const uint8_t TELEMETRY_VERSION = 2;
+const uint8_t TELEMETRY_TYPE_STATE = 1;
+const int TELEMETRY_BATCH = 4;              // frames per SerialBT write
+const int TELEMETRY_FRAME_MAX = 160;        // encoded bytes per frame, with margin
+
+int telemetry_hz = 10;                      // sample rate, 1..CONTROL_HZ
+volatile bool telemetry_active = false;     // SerialBT client connected
+
+struct ServoTelemetry {
+    s16 pos;
+    s16 load;
+    s16 current;
+    u8 temperature;
+    u8 voltage;
+};
+
+struct TelemetryFrame {
+    uint32_t stamp_ms;
+    uint8_t gait;
+    bool running;
+    uint16_t phase;                     // Q16
+    float h;
+    float t_cycle;
+    s16 commanded[SERVO_COUNT];
+    ControlStats control;
+    uint8_t feedback_ok;                // bit per servo, 0 = no feedback or gone stale
+    uint32_t feedback_ms;               // millis() of the read behind servo[]
+    ServoTelemetry servo[SERVO_COUNT];
+};
+
+Mailbox<TelemetryFrame> telemetry_mailbox;  // control task -> telemetry task
+TaskHandle_t TelemetryHandle = NULL;
+
+// Control task: bus ticks between feedback reads at the current rates
+int telemetry_feedback_every() {
+    int hz = telemetry_hz < 1 ? 1 : telemetry_hz;
+    int every = control_period_us ? (int)(1000000 / control_period_us) / hz : 1;
+    return every < 1 ? 1 : every;
+}
+
+// Feedback older than two read intervals is no longer being refreshed
+uint32_t feedback_stale_ms() {
+    int hz = telemetry_hz < 1 ? 1 : telemetry_hz;
+    return 2000 / hz;
+}
+
+uint16_t crc16_ccitt(const uint8_t* data, int len) {
+    uint16_t crc = 0xFFFF;
+    for (int i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// COBS encode len bytes plus the 0x00 delimiter; returns bytes written
+int cobs_encode(const uint8_t* in, int len, uint8_t* out) {
+    int code_pos = 0;
+    int o = 1;
+    uint8_t code = 1;
+
+    for (int i = 0; i < len; i++) {
+        if (in[i] == 0) {
+            out[code_pos] = code;
+            code_pos = o++;
+            code = 1;
+        } else {
+            out[o++] = in[i];
+            if (++code == 0xFF) {
+                out[code_pos] = code;
+                code_pos = o++;
+                code = 1;
+            }
+        }
+    }
+    out[code_pos] = code;
+    out[o++] = 0;
+    return o;
+}
+
+struct TelemetryWriter {
+    uint8_t buf[TELEMETRY_FRAME_MAX];
+    int len;
+
+    void u8(uint8_t v) { buf[len++] = v; }
+    void u16(uint16_t v) { u8(v & 0xFF); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v & 0xFFFF); u16(v >> 16); }
+};
+
+uint16_t clamp_u16(uint32_t v) { return v > 0xFFFF ? 0xFFFF : v; }
+
+// Pack one state record; returns the encoded frame length
+int telemetry_encode(const TelemetryFrame& t, uint16_t seq, uint8_t* out) {
+    TelemetryWriter w;
+    w.len = 0;
+
+    w.u8(TELEMETRY_VERSION);
+    w.u8(TELEMETRY_TYPE_STATE);
+    w.u16(seq);
+    w.u32(t.stamp_ms);
+
+    w.u8(t.gait);
+    w.u8((t.running ? 1 : 0) | (t.feedback_ok ? 2 : 0));
+    w.u16(t.phase);
+    w.u8((uint8_t)t.h);
+    w.u8((uint8_t)(t.t_cycle * 10 + 0.5f));
+    for (int i = 0; i < SERVO_COUNT; i++) w.u16(t.commanded[i]);
+
+    w.u32(t.control.ticks);
+    w.u32(t.control.overruns);
+    w.u32(t.control.missed);
+    w.u16(clamp_u16(t.control.jitter_avg));
+    w.u16(clamp_u16(t.control.jitter_max));
+    w.u16(clamp_u16(t.control.exec_max));
+
+    w.u8(t.feedback_ok);
+    w.u16(clamp_u16(t.stamp_ms - t.feedback_ms));
+    for (int i = 0; i < SERVO_COUNT; i++) {
+        const ServoTelemetry& s = t.servo[i];
+        w.u16(s.pos);
+        w.u16(s.load);
+        w.u16(s.current);
+        w.u8(s.temperature);
+        w.u8(s.voltage);
+    }
+
+    w.u16(crc16_ccitt(w.buf, w.len));
+    return cobs_encode(w.buf, w.len, out);
+}
+
+void telemetry_task(void* arg) {
+    TelemetryFrame t;
+    uint8_t batch[TELEMETRY_BATCH * TELEMETRY_FRAME_MAX];
+    int batch_len = 0;
+    int batch_frames = 0;
+    uint16_t seq = 0;
+    TickType_t wake = xTaskGetTickCount();
+
+    for (;;) {
+        int hz = telemetry_hz < 1 ? 1 : telemetry_hz;
+        vTaskDelayUntil(&wake, pdMS_TO_TICKS(1000 / hz));
+
+        // SerialBT carries binary frames only - latency dumps go to Serial
+        if (lat_dump_request) {
+            lat_dump_request = false;
+            latency_dump(Serial);
+        }
+
+        telemetry_active = SerialBT.hasClient();
+        if (!telemetry_active) {
+            batch_len = batch_frames = 0;
+            continue;
+        }
+        if (!telemetry_mailbox.take(t)) continue;
+
+        batch_len += telemetry_encode(t, seq++, batch + batch_len);
+        if (++batch_frames < TELEMETRY_BATCH) continue;
+
+        SerialBT.write(batch, batch_len);
+        batch_len = batch_frames = 0;
+    }
+}
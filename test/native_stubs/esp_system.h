@@ -0,0 +1,20 @@
+/* Host stand-in for ESP-IDF's esp_system.h: just enough for ps4.c to build
+   in the native env. The test that links ps4.c defines the function. */
+#ifndef ESP_SYSTEM_H
+#define ESP_SYSTEM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int esp_err_t;
+
+esp_err_t esp_base_mac_addr_set(const uint8_t* mac);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
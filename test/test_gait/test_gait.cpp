@@ -0,0 +1,299 @@
+// Gait kernel: accuracy of the Q15 sine table and integer curves against the
+// float versions they replaced, the shape and leg caches against the direct
+// computation, and ns/leg for each
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "gait.h"
+
+// Float kernels and per-leg fmod phase as they were before the Q16 phase
+namespace legacy {
+
+struct GaitParams {
+    float x_amps[4];
+    float z_amps[4];
+    float x_offsets[4];
+    float phase_offsets[4];
+};
+
+const GaitParams CREEP_FORWARD_PARAMS = {
+    {-x_amp, x_amp, -x_amp, x_amp},
+    {z_amp, -z_amp, -z_amp, z_amp},
+    {90 - OFFSET_FRONT, 90 + OFFSET_FRONT, 90 + OFFSET_BACK, 90 - OFFSET_BACK},
+    {0.00, 0.50, 0.25, 0.75}
+};
+
+void creep_gait(float x_amp, float z_amp, float x_off, float z_off, float phase, float& z, float& x) {
+    if (phase < 0.25f) {
+        z = z_off + z_amp * sin(phase / 0.25f * M_PI);
+        x = x_off + x_amp * sin(phase / 0.25f * M_PI / 2.0f);
+    } else {
+        z = z_off;
+        float returning = (phase - 0.25f) / 0.75f;
+        x = x_off + x_amp * (1.0f - returning);
+    }
+}
+
+void trot_gait(float x_amp, float z_amp, float x_off, float z_off, float phase, float& z, float& x) {
+    if (phase < 0.5f) {
+        z = z_off + z_amp * sin(phase * 2.0f * M_PI);
+        x = x_off + x_amp * sin(phase * M_PI);
+    } else {
+        z = z_off;
+        x = x_off + x_amp * cos((phase - 0.5f) * M_PI);
+    }
+}
+
+void calculate_gait_angles(const GaitParams& params, float phase, float height, float angles[4][2]) {
+    float dynamic_z_offsets[4] = {90 - height, 90 + height, 90 + height, 90 - height};
+    for (int i = 0; i < 4; i++) {
+        float current_phase = fmod(phase + params.phase_offsets[i], 1.0f);
+        creep_gait(params.x_amps[i], params.z_amps[i], params.x_offsets[i],
+                   dynamic_z_offsets[i], current_phase, angles[i][1], angles[i][0]);
+    }
+}
+
+}  // namespace legacy
+
+// Q16 kernel on one preset, as calculate_gait_angles ran it before blending
+static void q15_gait_angles(const GaitParams& params, uint16_t phase, int height, int angles[4][2]) {
+    int dynamic_z_offsets[4] = {90 - height, 90 + height, 90 + height, 90 - height};
+    for (int i = 0; i < 4; i++) {
+        creep_gait(params.x_amps[i], params.z_amps[i], params.x_offsets[i],
+                   dynamic_z_offsets[i], phase + params.phase_offsets[i], angles[i][1], angles[i][0]);
+    }
+}
+
+static double now_ns() {
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const int BENCH_REPS = 200;
+volatile int sink;
+
+void setUp(void) {
+    gait_style = GAIT_CREEP;
+    running = false;
+}
+
+void tearDown(void) {}
+
+void test_sin_q15_error(void) {
+    double worst = 0;
+    for (uint32_t a = 0; a < 65536; a++) {
+        double err = fabs(sin_q15(a) / 32767.0 - sin(a * 2 * M_PI / 65536));
+        if (err > worst) worst = err;
+    }
+    printf("sin_q15 max error %.2e\n", worst);
+    // Linear interpolation over 1/256 of a cycle, (2pi/256)^2/8 ~ 7.5e-5,
+    // plus Q15 rounding of the table and the interpolated step
+    TEST_ASSERT_LESS_OR_EQUAL(1.5e-4, worst);
+}
+
+// Integer curves round to nearest, the float ones were truncated by the
+// caller, so compare against the rounded float value
+void test_kernels_match_float(void) {
+    int worst_creep = 0, worst_trot = 0;
+    for (uint32_t p = 0; p < 65536; p += 7) {
+        float fz, fx;
+        int z, x;
+        legacy::creep_gait(-x_amp, z_amp, 90, 70, p / 65536.0f, fz, fx);
+        creep_gait(-x_amp, z_amp, 90, 70, p, z, x);
+        worst_creep = fmax(worst_creep, fmax(fabs(z - lroundf(fz)), fabs(x - lroundf(fx))));
+
+        legacy::trot_gait(x_amp, -z_amp, 45, 110, p / 65536.0f, fz, fx);
+        trot_gait(x_amp, -z_amp, 45, 110, p, z, x);
+        worst_trot = fmax(worst_trot, fmax(fabs(z - lroundf(fz)), fabs(x - lroundf(fx))));
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(1, worst_creep);
+    TEST_ASSERT_LESS_OR_EQUAL(1, worst_trot);
+}
+
+// The blended path at full forward stride draws the same curves
+void test_blend_matches_float(void) {
+    GaitCommand cmd = {1, 0, 0};
+    GaitBlend b = gait_blend(cmd, GAIT_CREEP);
+    int worst = 0;
+    for (uint32_t p = 0; p < 65536; p += 13) {
+        float f[4][2];
+        int a[4][2];
+        legacy::calculate_gait_angles(legacy::CREEP_FORWARD_PARAMS, p / 65536.0f, 20, f);
+        calculate_gait_angles(b, p, 20, a);
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 2; j++)
+                worst = fmax(worst, fabs(a[i][j] - lroundf(f[i][j])));
+    }
+    TEST_ASSERT_LESS_OR_EQUAL(1, worst);
+}
+
+// Interpolated shape table against the curve it was baked from
+void test_shape_table(void) {
+    for (int style = 0; style < GAIT_STYLE_COUNT; style++) {
+        int worst = 0;
+        for (uint32_t p = 0; p < 65536; p++) {
+            int l, s, lc, sc;
+            gait_shape((GaitStyle)style, p, l, s);
+            gait_shape_curve((GaitStyle)style, p, lc, sc);
+            worst = fmax(worst, fmax(abs(l - lc), abs(s - sc)));
+        }
+        printf("style %d shape table max error %d/%d\n", style, worst, GAIT_UNIT);
+        TEST_ASSERT_LESS_OR_EQUAL(1, worst);
+    }
+}
+
+// Cached leg mixes follow the blend: same weights reuse, new weights remix
+void test_leg_cache(void) {
+    GaitCommand cmds[] = {{1, 0, 0}, {0.5f, 0, 0}, {0.4f, 0.3f, 0}, {0, 0, -0.7f}, {-0.2f, 0.1f, 0.3f}};
+    for (int style = 0; style < GAIT_STYLE_COUNT; style++) {
+        for (unsigned c = 0; c < sizeof(cmds) / sizeof(cmds[0]); c++) {
+            GaitBlend b = gait_blend(cmds[c], (GaitStyle)style);
+            const LegGait* legs = blend_legs(b);
+            for (int i = 0; i < 4; i++) {
+                LegGait g = blend_leg(b, i);
+                TEST_ASSERT_EQUAL(g.x_amp, legs[i].x_amp);
+                TEST_ASSERT_EQUAL(g.z_amp, legs[i].z_amp);
+                TEST_ASSERT_EQUAL(g.x_mid, legs[i].x_mid);
+                TEST_ASSERT_EQUAL(g.phase_off, legs[i].phase_off);
+            }
+        }
+    }
+}
+
+// Reversing a command while walking, straight through zero or just past it:
+// no joint steps further in one 100 Hz tick than a few degrees (the walk
+// itself moves up to 2), and the mix is back to the plain preset from
+// GAIT_STANCE_BAND up
+void test_reverse_continuous(void) {
+    const float misses[] = {0, 0.01f, 0.03f, 0.1f};
+    for (int style = 0; style < GAIT_STYLE_COUNT; style++) {
+        for (int axis = 0; axis < 3; axis++) {
+            for (float miss : misses) {
+                GaitCommand cmd = {0, 0, 0}, target = {0, 0, 0};
+                float* c = &cmd.vx;
+                float* t = &target.vx;
+                c[axis] = 1;
+                t[axis] = -1;
+                c[(axis + 1) % 3] = t[(axis + 1) % 3] = miss;
+
+                uint16_t phase = 12345;
+                int prev[4][2];
+                int worst = 0;
+                for (int k = 0; k < 150; k++) {
+                    gait_slew(cmd, target, 10000);
+                    phase += (uint16_t)(65536 * 0.01 / 1.5);
+                    int a[4][2];
+                    calculate_gait_angles(gait_blend(cmd, (GaitStyle)style), phase, 20, a);
+                    for (int i = 0; k && i < 4; i++)
+                        for (int j = 0; j < 2; j++) worst = fmax(worst, abs(a[i][j] - prev[i][j]));
+                    memcpy(prev, a, sizeof(prev));
+                }
+                TEST_ASSERT_LESS_OR_EQUAL(3, worst);
+
+                GaitBlend b = gait_blend(cmd, (GaitStyle)style);
+                TEST_ASSERT_EQUAL_INT32_ARRAY(b.weight, b.stance, GAIT_DIRECTIONS);
+            }
+        }
+    }
+    // Inside the band the stance eases to the rest mix, the swing does not
+    GaitCommand slow_back = {-GAIT_STANCE_BAND / 2, 0, 0};
+    GaitBlend b = gait_blend(slow_back, GAIT_CREEP);
+    TEST_ASSERT_EQUAL(32768, b.weight[CREEP_BACKWARD]);
+    TEST_ASSERT_EQUAL(16384, b.stance[CREEP_BACKWARD]);
+    TEST_ASSERT_EQUAL(16384, b.stance[CREEP_FORWARD]);
+}
+
+// calculate_gait_angles without either cache
+static void direct_gait_angles(const GaitBlend& b, uint16_t phase, int height, int angles[4][2]) {
+    int dynamic_z_offsets[4] = {90 - height, 90 + height, 90 + height, 90 - height};
+    int32_t stride = b.stride >> 5;
+    for (int i = 0; i < 4; i++) {
+        LegGait g = blend_leg(b, i);
+        int lift, s;
+        gait_shape_curve(b.style, phase + g.phase_off, lift, s);
+        int32_t swing = ((2 * s - GAIT_UNIT) * g.x_amp * stride + (1 << 19)) >> 20;
+        angles[i][0] = (g.x_mid + swing + 1) >> 1;
+        angles[i][1] = dynamic_z_offsets[i] + ((g.z_amp * lift + GAIT_UNIT / 2) >> GAIT_SHIFT);
+    }
+}
+
+void test_bench_ns_per_leg(void) {
+    const int steps = 256;
+    const uint16_t dp = 65536 / steps;
+    const GaitParams& preset = GAIT_CONFIGS[CREEP_FORWARD];
+    int acc = 0;
+
+    double t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            float f[4][2];
+            legacy::calculate_gait_angles(legacy::CREEP_FORWARD_PARAMS, s / (float)steps, 20, f);
+            acc += (int)f[r & 3][0];
+        }
+    }
+    double legacy_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            q15_gait_angles(preset, (uint16_t)(s * dp), 20, a);
+            acc += a[r & 3][0];
+        }
+    }
+    double q15_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+
+    GaitCommand cmd = {0.6f, 0.3f, -0.2f};
+    GaitBlend b = gait_blend(cmd, GAIT_CREEP);
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            calculate_gait_angles(b, (uint16_t)(s * dp), 20, a);
+            acc += a[r & 3][0];
+        }
+    }
+    double blend_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+
+    int worst = 0;
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            direct_gait_angles(b, (uint16_t)(s * dp), 20, a);
+            acc += a[r & 3][0];
+        }
+    }
+    double direct_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+    for (int s = 0; s < steps; s++) {
+        int a[4][2], d[4][2];
+        calculate_gait_angles(b, (uint16_t)(s * dp + 77), 20, a);
+        direct_gait_angles(b, (uint16_t)(s * dp + 77), 20, d);
+        for (int i = 0; i < 4; i++)
+            for (int j = 0; j < 2; j++) worst = fmax(worst, abs(a[i][j] - d[i][j]));
+    }
+    sink = acc;
+
+    printf("float/fmod kernel %.1f ns/leg, Q15 kernel %.1f ns/leg (%.1fx)\n",
+           legacy_ns, q15_ns, legacy_ns / q15_ns);
+    printf("blended command %.1f ns/leg cached, %.1f ns/leg direct (%.1fx)\n",
+           blend_ns, direct_ns, direct_ns / blend_ns);
+    TEST_ASSERT_LESS_THAN(legacy_ns, q15_ns);
+    TEST_ASSERT_LESS_THAN(direct_ns, blend_ns);
+    TEST_ASSERT_LESS_OR_EQUAL(1, worst);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_sin_q15_error);
+    RUN_TEST(test_kernels_match_float);
+    RUN_TEST(test_blend_matches_float);
+    RUN_TEST(test_shape_table);
+    RUN_TEST(test_leg_cache);
+    RUN_TEST(test_reverse_continuous);
+    RUN_TEST(test_bench_ns_per_leg);
+    return UNITY_END();
+}
@@ -0,0 +1,192 @@
+// Leg IK: closed-form solver against its forward kinematics, the foot-space
+// gaits against the joint-space curves they replace, and ns per solve
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+// Arduino.h macros used by ik.h
+#define radians(deg) ((deg) * M_PI / 180.0)
+#define degrees(rad) ((rad) * 180.0 / M_PI)
+
+#include "gait.h"
+#include "ik.h"
+
+static const int BENCH_REPS = 200;
+volatile int sink;
+
+static const float HEIGHTS[] = {10, 20, 30};
+static const GaitCommand COMMANDS[] = {
+    {1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}, {0.6f, 0.3f, -0.2f}
+};
+
+static double now_ns() {
+    return std::chrono::duration<double, std::nano>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static const ServoMapping& joint(int leg, Axis axis) {
+    int i = 0;
+    while (SERVO_MAPPING[i].leg != leg || SERVO_MAPPING[i].axis != axis) i++;
+    return SERVO_MAPPING[i];
+}
+
+void setUp(void) {
+    gait_style = GAIT_CREEP;
+    running = false;
+}
+
+void tearDown(void) {}
+
+// Every whole-degree pose inside the servo limits comes back unchanged, as
+// long as the foot stays outside the hip: past ~60 deg of lift the leg
+// points straight down and the yaw is undefined
+void test_fk_ik_round_trip(void) {
+    int worst = 0, poses = 0;
+    for (int leg = 0; leg < 4; leg++) {
+        const ServoMapping& jx = joint(leg, AXIS_X);
+        const ServoMapping& jz = joint(leg, AXIS_Z);
+        for (int x = jx.min_angle; x <= jx.max_angle; x++) {
+            for (int z = jz.min_angle; z <= jz.max_angle; z++) {
+                if (LEG_GEOMETRY[leg].lift_sign * (z - 90) > 55) continue;
+                FootTargets t;
+                for (int i = 0; i < 4; i++) leg_fk(i, 90, 90, t.x[i], t.y[i], t.z[i]);
+                leg_fk(leg, x, z, t.x[leg], t.y[leg], t.z[leg]);
+
+                int a[4][2];
+                ik_solve(t, a);
+                worst = fmax(worst, fmax(abs(a[leg][AXIS_X] - x), abs(a[leg][AXIS_Z] - z)));
+                poses++;
+            }
+        }
+    }
+    printf("FK -> IK: %d poses, max error %d deg\n", poses, worst);
+    TEST_ASSERT_EQUAL(0, worst);
+}
+
+// Same hip swing as the joint-space gait to within a degree, the same lift
+// angle whenever the foot is on the ground
+void test_matches_joint_space(void) {
+    for (unsigned c = 0; c < sizeof(COMMANDS) / sizeof(COMMANDS[0]); c++) {
+        for (int style = 0; style < GAIT_STYLE_COUNT; style++) {
+            GaitBlend b = gait_blend(COMMANDS[c], (GaitStyle)style);
+            const LegGait* legs = blend_legs(b);
+            for (float hd : HEIGHTS) {
+                int worst_hip = 0, worst_stance = 0;
+                for (uint32_t p = 0; p < 65536; p += 97) {
+                    int joint_space[4][2], foot_space[4][2];
+                    calculate_gait_angles(b, p, hd, joint_space);
+                    calculate_gait_angles_ik(b, p, hd, foot_space);
+                    for (int i = 0; i < 4; i++) {
+                        worst_hip = fmax(worst_hip, abs(joint_space[i][AXIS_X] - foot_space[i][AXIS_X]));
+                        int lift, s;
+                        gait_shape(b.style, p + legs[i].phase_off, lift, s);
+                        if (lift == 0)
+                            worst_stance = fmax(worst_stance, abs(joint_space[i][AXIS_Z] - foot_space[i][AXIS_Z]));
+                    }
+                }
+                TEST_ASSERT_LESS_OR_EQUAL(1, worst_hip);
+                TEST_ASSERT_EQUAL(0, worst_stance);
+            }
+        }
+    }
+}
+
+// The point of foot space: the swing lifts the foot FOOT_LIFT mm at every
+// body height, where the joint-space curve lifts it z_amp degrees
+void test_swing_lift(void) {
+    GaitBlend b = gait_blend(COMMANDS[0], GAIT_CREEP);
+    for (float hd : HEIGHTS) {
+        float ground = 0, top = -1e9;
+        for (uint32_t p = 0; p < 65536; p += 61) {
+            int a[4][2];
+            calculate_gait_angles_ik(b, p, hd, a);
+            float x, y, z;
+            leg_fk(LEG_LF, a[LEG_LF][AXIS_X], a[LEG_LF][AXIS_Z], x, y, z);
+            if (p == 0 || z < ground) ground = z;
+            if (z > top) top = z;
+        }
+        printf("h %.0f: body height %.1f mm, foot lift %.1f mm\n", hd, -ground, top - ground);
+        // Whole-degree servo angles: 1 deg of lift is about 1.2 mm of foot
+        TEST_ASSERT_FLOAT_WITHIN(2.0, FOOT_LIFT, top - ground);
+    }
+}
+
+// Forward to reverse while walking: the foot-space path stays continuous
+// through zero too (test_gait checks the joint-space one)
+void test_reverse_continuous(void) {
+    for (int style = 0; style < GAIT_STYLE_COUNT; style++) {
+        GaitCommand cmd = {1, 0.01f, 0}, target = {-1, 0.01f, 0};
+        uint16_t phase = 12345;
+        int prev[4][2];
+        int worst = 0;
+        for (int k = 0; k < 150; k++) {
+            gait_slew(cmd, target, 10000);
+            phase += (uint16_t)(65536 * 0.01 / 1.5);
+            int a[4][2];
+            calculate_gait_angles_ik(gait_blend(cmd, (GaitStyle)style), phase, 20, a);
+            for (int i = 0; k && i < 4; i++)
+                for (int j = 0; j < 2; j++) worst = fmax(worst, abs(a[i][j] - prev[i][j]));
+            memcpy(prev, a, sizeof(prev));
+        }
+        printf("style %d forward to reverse: max step %d deg/tick\n", style, worst);
+        TEST_ASSERT_LESS_OR_EQUAL(4, worst);
+    }
+}
+
+void test_bench_ns_per_leg(void) {
+    const int steps = 256;
+    const uint16_t dp = 65536 / steps;
+    GaitBlend b = gait_blend(COMMANDS[6], GAIT_CREEP);
+    int acc = 0;
+
+    FootTargets feet[steps];
+    for (int s = 0; s < steps; s++) foot_gait_targets(b, (uint16_t)(s * dp), h, feet[s]);
+
+    double t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            ik_solve(feet[s], a);
+            acc += a[r & 3][0];
+        }
+    }
+    double solve_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            calculate_gait_angles_ik(b, (uint16_t)(s * dp), h, a);
+            acc += a[r & 3][0];
+        }
+    }
+    double ik_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+
+    t0 = now_ns();
+    for (int r = 0; r < BENCH_REPS; r++) {
+        for (int s = 0; s < steps; s++) {
+            int a[4][2];
+            calculate_gait_angles(b, (uint16_t)(s * dp), h, a);
+            acc += a[r & 3][0];
+        }
+    }
+    double joint_ns = (now_ns() - t0) / (BENCH_REPS * steps * 4.0);
+    sink = acc;
+
+    printf("ik_solve %.1f ns/leg; foot-space gait %.1f ns/leg, joint-space gait %.1f ns/leg\n",
+           solve_ns, ik_ns, joint_ns);
+    // Far inside a 10 ms control tick even at the ESP32's ~20x slower float
+    TEST_ASSERT_LESS_THAN(1000, ik_ns);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_fk_ik_round_trip);
+    RUN_TEST(test_matches_joint_space);
+    RUN_TEST(test_swing_lift);
+    RUN_TEST(test_reverse_continuous);
+    RUN_TEST(test_bench_ns_per_leg);
+    return UNITY_END();
+}
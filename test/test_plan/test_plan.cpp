@@ -0,0 +1,130 @@
+// Motion planning: segment profiles against a model of the servo running
+// them - ramps, acceleration limit, arrival together, closed-loop tracking
+#include <math.h>
+#include <stdio.h>
+#include <unity.h>
+
+#include "plan.h"
+
+static const float TICK = 0.01;             // 100 Hz control tick
+static const int SPEED_MAX = 2400;          // servo.h speed
+
+// Register values as servo.h sends them
+static int speed_units(const PlanProfile& p) {
+    long v = lroundf(p.v);
+    return v < PLAN_SPEED_MIN ? PLAN_SPEED_MIN : (v > SPEED_MAX ? SPEED_MAX : (int)v);
+}
+
+static int acc_units(const PlanProfile& p) {
+    int a = (int)ceilf(p.a / 100);
+    return a < 1 ? 1 : (a > PLAN_ACC_MAX ? PLAN_ACC_MAX : a);
+}
+
+// Time a servo at rest-relative speed u0 takes to settle d steps away
+static float arrival(float d, float u0, const PlanProfile& p) {
+    ServoModel m;
+    model_reset(m, 0);
+    m.vel = u0;
+    model_start(m, d, speed_units(p), acc_units(p));
+    const float dt = 0.0005;
+    for (float t = 0; t < 2; t += dt) {
+        if (fabsf(m.pos - d) < 0.05f && fabsf(m.vel) < 20) return t;
+        model_advance(m, dt);
+    }
+    return 2;
+}
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void test_cruise_from_rest() {
+    // Only the middle of the segment cruises, so it must go faster than d / t
+    PlanProfile p = plan_profile(100, 0, 0.5);
+    TEST_ASSERT_FLOAT_WITHIN(1, 100 / (0.5 * (1 - PLAN_RAMP)), p.v);
+    TEST_ASSERT_FLOAT_WITHIN(1, p.v / (PLAN_RAMP * 0.5), p.a);
+    TEST_ASSERT_FLOAT_WITHIN(0.05 * 0.5, 0.5, arrival(100, 0, p));
+}
+
+void test_acc_limit_stretches() {
+    // 170 steps in one 10 ms tick would need ~1e7 steps/s^2
+    float d = 170, u0 = 0;
+    PlanProfile p;
+    float t = plan_segment(1, &d, &u0, TICK, SPEED_MAX, &p);
+    TEST_ASSERT_GREATER_THAN(TICK, t);
+    TEST_ASSERT_LESS_OR_EQUAL(PLAN_ACC_LIMIT, p.a);
+    TEST_ASSERT_FLOAT_WITHIN(0.1 * t, t, arrival(170, 0, p));
+}
+
+void test_speed_limit_stretches() {
+    float d = 3000, u0 = 0;
+    PlanProfile p;
+    float t = plan_segment(1, &d, &u0, TICK, SPEED_MAX, &p);
+    TEST_ASSERT_GREATER_OR_EQUAL(3000 / (SPEED_MAX * (1 - PLAN_RAMP)), t);
+    TEST_ASSERT_LESS_OR_EQUAL(SPEED_MAX + 1, p.v);
+}
+
+void test_arrive_together() {
+    // Different distances and starting speeds, some moving away from the goal
+    const int n = 6;
+    const float d[n] = {5, 40, 170, 300, 600, 120};
+    const float u0[n] = {0, 800, -400, 1500, 0, 200};
+    PlanProfile p[n];
+    float t = plan_segment(n, d, u0, TICK, SPEED_MAX, p);
+    TEST_ASSERT_GREATER_THAN(TICK, t);
+    for (int i = 0; i < n; i++) {
+        TEST_ASSERT_LESS_OR_EQUAL(PLAN_ACC_LIMIT, p[i].a);
+        float at = arrival(d[i], u0[i], p[i]);
+        printf("d %4.0f u0 %5.0f: v %6.1f a %7.0f arrives %.4f of %.4f s\n",
+               d[i], u0[i], p[i].v, p[i].a, at, t);
+        TEST_ASSERT_FLOAT_WITHIN(0.15 * t, t, at);
+    }
+}
+
+void test_refresh_recovers() {
+    // A refresh of an unchanged target the model has already reached, while
+    // the servo itself missed the last frame and is still 170 steps short
+    float d = 0, u0 = 0;
+    PlanProfile p;
+    plan_segment(1, &d, &u0, TICK, SPEED_MAX, &p);
+    TEST_ASSERT_EQUAL(SPEED_MAX, speed_units(p));
+    TEST_ASSERT_EQUAL(PLAN_ACC_MAX, acc_units(p));
+    float at = arrival(170, 0, p);
+    printf("refresh: 170 steps missed, back on target in %.4f s\n", at);
+    TEST_ASSERT_LESS_THAN(0.2, at);
+}
+
+void test_tracking_100hz() {
+    // commit_frame() at 100 Hz against a servo running the sent profiles:
+    // the model stays on the servo and the servo close behind the target
+    ServoModel servo, model;
+    const float amp = 170, period = 1.5;
+    model_reset(servo, 0);
+    model_reset(model, 0);
+    float lag_max = 0;
+    for (int k = 1; k <= 300; k++) {
+        model_advance(servo, TICK);
+        model_advance(model, TICK);
+        float target = roundf(amp * sinf(2 * M_PI * k * TICK / period));
+        float dd = target - model.pos;
+        float d = fabsf(dd), u0 = dd < 0 ? -model.vel : model.vel;
+        PlanProfile p;
+        plan_segment(1, &d, &u0, TICK, SPEED_MAX, &p);
+        TEST_ASSERT_LESS_OR_EQUAL(PLAN_ACC_LIMIT, p.a);
+        model_start(servo, target, speed_units(p), acc_units(p));
+        model_start(model, target, speed_units(p), acc_units(p));
+        if (k > 50 && fabsf(target - servo.pos) > lag_max) lag_max = fabsf(target - servo.pos);
+    }
+    printf("tracking %g steps at %.1f s: max lag %.1f steps\n", amp, period, lag_max);
+    TEST_ASSERT_LESS_THAN(30, lag_max);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_cruise_from_rest);
+    RUN_TEST(test_acc_limit_stretches);
+    RUN_TEST(test_speed_limit_stretches);
+    RUN_TEST(test_arrive_together);
+    RUN_TEST(test_refresh_recovers);
+    RUN_TEST(test_tracking_100hz);
+    return UNITY_END();
+}
@@ -0,0 +1,124 @@
+/* Baseline ps4.h types for legacy_parser.c */
+#ifndef LEGACY_PARSER_H
+#define LEGACY_PARSER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/********************/
+/*    A N A L O G   */
+/********************/
+
+typedef struct {
+  int8_t lx;
+  int8_t ly;
+  int8_t rx;
+  int8_t ry;
+} legacy_ps4_analog_stick_t;
+
+typedef struct {
+  uint8_t l2;
+  uint8_t r2;
+} legacy_ps4_analog_button_t;
+
+typedef struct {
+  legacy_ps4_analog_stick_t stick;
+  legacy_ps4_analog_button_t button;
+} legacy_ps4_analog_t;
+
+/*********************/
+/*   B U T T O N S   */
+/*********************/
+
+typedef struct {
+  uint8_t right : 1;
+  uint8_t down : 1;
+  uint8_t up : 1;
+  uint8_t left : 1;
+
+  uint8_t square : 1;
+  uint8_t cross : 1;
+  uint8_t circle : 1;
+  uint8_t triangle : 1;
+
+  uint8_t upright : 1;
+  uint8_t downright : 1;
+  uint8_t upleft : 1;
+  uint8_t downleft : 1;
+
+  uint8_t l1 : 1;
+  uint8_t r1 : 1;
+  uint8_t l2 : 1;
+  uint8_t r2 : 1;
+
+  uint8_t share : 1;
+  uint8_t options : 1;
+  uint8_t l3 : 1;
+  uint8_t r3 : 1;
+
+  uint8_t ps : 1;
+  uint8_t touchpad : 1;
+} legacy_ps4_button_t;
+
+/*******************************/
+/*   S T A T U S   F L A G S   */
+/*******************************/
+
+typedef struct {
+  uint8_t battery;
+  uint8_t charging : 1;
+  uint8_t audio : 1;
+  uint8_t mic : 1;
+} legacy_ps4_status_t;
+
+/********************/
+/*   S E N S O R S  */
+/********************/
+
+typedef struct {
+  int16_t z;
+} legacy_ps4_sensor_gyroscope_t;
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t z;
+} legacy_ps4_sensor_accelerometer_t;
+
+typedef struct {
+  legacy_ps4_sensor_accelerometer_t accelerometer;
+  legacy_ps4_sensor_gyroscope_t gyroscope;
+} legacy_ps4_sensor_t;
+
+/*******************/
+/*    O T H E R    */
+/*******************/
+
+typedef struct {
+  legacy_ps4_button_t button_down;
+  legacy_ps4_button_t button_up;
+  legacy_ps4_analog_t analog_move;
+} legacy_ps4_event_t;
+
+typedef struct {
+  legacy_ps4_analog_t analog;
+  legacy_ps4_button_t button;
+  legacy_ps4_status_t status;
+  legacy_ps4_sensor_t sensor;
+  uint8_t* latestPacket;
+} legacy_ps4_t;
+
+void legacy_parsePacket(uint8_t* packet);
+legacy_ps4_button_t legacy_parsePacketButtons(uint8_t* packet);
+legacy_ps4_event_t legacy_parseEvent(legacy_ps4_t prev, legacy_ps4_t cur);
+void legacy_ps4PacketEvent(legacy_ps4_t ps4, legacy_ps4_event_t event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
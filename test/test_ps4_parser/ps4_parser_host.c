@@ -0,0 +1,3 @@
+/* PS4Controller is ignored in the native env (its Bluetooth sources need the
+   esp32 stack), so the report parser is built into the test from here */
+#include "../../lib/PS4-esp32-master/src/ps4_parser.c"
@@ -0,0 +1,209 @@
+// HID report parser: the packed, branch-free parser against the per-field
+// one it replaced - same decoded state, and cycles per report for each
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+extern "C" {
+#include "ps4.h"
+#include "ps4_int.h"
+#include "legacy_parser.h"
+
+// ps4_parser.c locals, for timing the button stage on its own
+ps4_button_t parsePacketButtons(uint8_t* packet);
+ps4_event_t parseEvent(ps4_button_t prevButtons, const ps4_t* cur);
+}
+
+static const int REPORT_LEN = PS4_HID_BUFFER_SIZE;
+static const int REPORTS = 1024;
+static const int BENCH_REPS = 200;
+
+static uint8_t reports[REPORTS][REPORT_LEN];
+
+static ps4_t last;
+static ps4_event_t last_event;
+static legacy_ps4_t legacy_last;
+static unsigned long packets;
+volatile uint32_t sink;
+
+extern "C" void ps4PacketEvent(ps4_t ps4, ps4_event_t event) {
+    last = ps4;
+    last_event = event;
+    packets++;
+}
+
+extern "C" void legacy_ps4PacketEvent(legacy_ps4_t ps4, legacy_ps4_event_t event) {
+    legacy_last = ps4;
+    packets++;
+}
+
+static uint32_t lcg = 1;
+static uint8_t rnd() {
+    lcg = lcg * 1103515245 + 12345;
+    return lcg >> 16;
+}
+
+// Random sticks and triggers; buttons change on about one report in eight,
+// the D-pad nibble only takes the values a controller sends (0-8)
+static void make_reports() {
+    uint8_t buttons[3] = {8, 0, 0};
+    for (int r = 0; r < REPORTS; r++) {
+        uint8_t* p = reports[r];
+        for (int i = 0; i < REPORT_LEN; i++) p[i] = rnd();
+        if ((rnd() & 7) == 0) {
+            buttons[0] = (rnd() & 0xF0) | (rnd() % 9);
+            buttons[1] = rnd();
+            buttons[2] = rnd() & 3;
+        }
+        p[17] = buttons[0];
+        p[18] = buttons[1];
+        p[19] = buttons[2];
+    }
+}
+
+static uint32_t legacy_mask(const legacy_ps4_button_t& b) {
+    return (b.right ? PS4_BUTTON_RIGHT : 0) | (b.down ? PS4_BUTTON_DOWN : 0) |
+           (b.up ? PS4_BUTTON_UP : 0) | (b.left ? PS4_BUTTON_LEFT : 0) |
+           (b.square ? PS4_BUTTON_SQUARE : 0) | (b.cross ? PS4_BUTTON_CROSS : 0) |
+           (b.circle ? PS4_BUTTON_CIRCLE : 0) | (b.triangle ? PS4_BUTTON_TRIANGLE : 0) |
+           (b.upright ? PS4_BUTTON_UPRIGHT : 0) | (b.downright ? PS4_BUTTON_DOWNRIGHT : 0) |
+           (b.upleft ? PS4_BUTTON_UPLEFT : 0) | (b.downleft ? PS4_BUTTON_DOWNLEFT : 0) |
+           (b.l1 ? PS4_BUTTON_L1 : 0) | (b.r1 ? PS4_BUTTON_R1 : 0) |
+           (b.l2 ? PS4_BUTTON_L2 : 0) | (b.r2 ? PS4_BUTTON_R2 : 0) |
+           (b.share ? PS4_BUTTON_SHARE : 0) | (b.options ? PS4_BUTTON_OPTIONS : 0) |
+           (b.l3 ? PS4_BUTTON_L3 : 0) | (b.r3 ? PS4_BUTTON_R3 : 0) |
+           (b.ps ? PS4_BUTTON_PS : 0) | (b.touchpad ? PS4_BUTTON_TOUCHPAD : 0);
+}
+
+static uint64_t ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+// Same buttons, sticks, triggers and status as the old parser on every report
+void test_decode_matches_legacy(void) {
+    for (int r = 0; r < REPORTS; r++) {
+        parsePacket(reports[r]);
+        legacy_parsePacket(reports[r]);
+        TEST_ASSERT_EQUAL_HEX32(legacy_mask(legacy_last.button), last.button);
+        TEST_ASSERT_EQUAL(legacy_last.analog.stick.lx, last.analog.stick.lx);
+        TEST_ASSERT_EQUAL(legacy_last.analog.stick.ly, last.analog.stick.ly);
+        TEST_ASSERT_EQUAL(legacy_last.analog.stick.rx, last.analog.stick.rx);
+        TEST_ASSERT_EQUAL(legacy_last.analog.stick.ry, last.analog.stick.ry);
+        TEST_ASSERT_EQUAL(legacy_last.analog.button.l2, last.analog.button.l2);
+        TEST_ASSERT_EQUAL(legacy_last.analog.button.r2, last.analog.button.r2);
+        TEST_ASSERT_EQUAL(legacy_last.status.battery, last.status.battery);
+        TEST_ASSERT_EQUAL(legacy_last.status.charging, last.status.charging);
+        TEST_ASSERT_EQUAL(legacy_last.status.audio, last.status.audio);
+        TEST_ASSERT_EQUAL(legacy_last.status.mic, last.status.mic);
+    }
+}
+
+// Every D-pad code decodes to exactly one direction, 8 to none
+void test_dpad(void) {
+    const uint32_t expected[9] = {
+        PS4_BUTTON_UP, PS4_BUTTON_UPRIGHT, PS4_BUTTON_RIGHT, PS4_BUTTON_DOWNRIGHT,
+        PS4_BUTTON_DOWN, PS4_BUTTON_DOWNLEFT, PS4_BUTTON_LEFT, PS4_BUTTON_UPLEFT, 0
+    };
+    uint8_t p[REPORT_LEN] = {0};
+    for (int code = 0; code < 9; code++) {
+        p[17] = 0xA0 | code;
+        parsePacket(p);
+        TEST_ASSERT_EQUAL_HEX32(expected[code] | PS4_BUTTON_CROSS | PS4_BUTTON_TRIANGLE, last.button);
+    }
+}
+
+static const char* tick_unit() {
+#if defined(__x86_64__) || defined(__i386__)
+    return "cycles";
+#else
+    return "ns";
+#endif
+}
+
+// Whole parsePacket: buttons, sticks, triggers, status and the event
+void test_bench_cycles_per_report(void) {
+    uint32_t acc = 0;
+
+    uint64_t t0 = ticks();
+    for (int k = 0; k < BENCH_REPS; k++) {
+        for (int r = 0; r < REPORTS; r++) {
+            legacy_parsePacket(reports[r]);
+            acc += legacy_last.analog.stick.lx;
+        }
+    }
+    double legacy = (double)(ticks() - t0) / (BENCH_REPS * REPORTS);
+
+    t0 = ticks();
+    for (int k = 0; k < BENCH_REPS; k++) {
+        for (int r = 0; r < REPORTS; r++) {
+            parsePacket(reports[r]);
+            acc += last.analog.stick.lx + last_event.button_down;
+        }
+    }
+    double packed = (double)(ticks() - t0) / (BENCH_REPS * REPORTS);
+    sink = acc;
+
+    // The new parser also decodes the IMU block the old one skipped, so the
+    // whole report is only reported, not asserted
+    printf("parsePacket: before %.1f %s/report, after %.1f %s/report (IMU decode included)\n",
+           legacy, tick_unit(), packed, tick_unit());
+}
+
+// Button decode and edge detection, the part the packed mask replaced
+void test_bench_cycles_buttons(void) {
+    uint32_t acc = 0;
+
+    legacy_ps4_t legacy_prev = {}, legacy_cur = {};
+    uint64_t t0 = ticks();
+    for (int k = 0; k < BENCH_REPS; k++) {
+        for (int r = 0; r < REPORTS; r++) {
+            legacy_cur.button = legacy_parsePacketButtons(reports[r]);
+            legacy_ps4_event_t e = legacy_parseEvent(legacy_prev, legacy_cur);
+            legacy_prev = legacy_cur;
+            acc += e.button_down.cross;
+        }
+    }
+    double legacy = (double)(ticks() - t0) / (BENCH_REPS * REPORTS);
+
+    ps4_t cur = {};
+    ps4_button_t prev = 0;
+    t0 = ticks();
+    for (int k = 0; k < BENCH_REPS; k++) {
+        for (int r = 0; r < REPORTS; r++) {
+            cur.button = parsePacketButtons(reports[r]);
+            ps4_event_t e = parseEvent(prev, &cur);
+            prev = cur.button;
+            acc += e.button_down;
+        }
+    }
+    double packed = (double)(ticks() - t0) / (BENCH_REPS * REPORTS);
+    sink = acc;
+
+    printf("buttons + edges: before %.1f %s/report, after %.1f %s/report (%.1fx)\n",
+           legacy, tick_unit(), packed, tick_unit(), legacy / packed);
+    TEST_ASSERT_LESS_THAN(legacy, packed);
+}
+
+int main(int argc, char **argv) {
+    make_reports();
+    UNITY_BEGIN();
+    RUN_TEST(test_decode_matches_legacy);
+    RUN_TEST(test_dpad);
+    RUN_TEST(test_bench_cycles_per_report);
+    RUN_TEST(test_bench_cycles_buttons);
+    return UNITY_END();
+}
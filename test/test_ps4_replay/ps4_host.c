@@ -0,0 +1,3 @@
+/* Connection and event dispatch (ps4PacketEvent) from the PS4 library, built
+   against test/native_stubs/esp_system.h; the test stubs the L2CAP/SPP side */
+#include "../../lib/PS4-esp32-master/src/ps4.c"
@@ -0,0 +1,343 @@
+// HID report replay: capture files fed through parsePacket and ps4PacketEvent
+// to the registered event callback, at real time, accelerated or flat out.
+// Measures parse throughput and report-to-callback latency and checks every
+// button edge against a reference decode of the raw report bytes.
+//
+// Capture file: "PS4CAP01", then one record per report - uint32 LE arrival
+// time in us from the start of the capture, then the PS4_HID_BUFFER_SIZE
+// report bytes exactly as handed to parsePacket(). Set PS4_REPLAY_CAPTURE to
+// a recorded file to replay it as well as the generated trace.
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+
+extern "C" {
+#include "ps4.h"
+#include "ps4_int.h"
+}
+#include "esp_system.h"
+
+// Bluetooth side of the library, not present on the host
+extern "C" {
+void sppInit() {}
+void ps4_l2cap_init_services() {}
+void ps4_l2cap_deinit_services() {}
+void ps4_l2cap_send_hid(hid_cmd_t* hid_cmd, uint8_t len) {}
+esp_err_t esp_base_mac_addr_set(const uint8_t* mac) { return 0; }
+}
+
+static const int REPORT_LEN = PS4_HID_BUFFER_SIZE;
+static const char CAPTURE_MAGIC[8] = {'P', 'S', '4', 'C', 'A', 'P', '0', '1'};
+static const uint32_t REPORT_PERIOD_US = 1250;     // 800 Hz, the controller's fastest rate
+static const int TRACE_REPORTS = 4000;              // 5 s
+
+struct CaptureRecord {
+    uint32_t t_us;
+    uint8_t report[REPORT_LEN];
+};
+
+static uint64_t now_us() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/*************************/
+/*   C A P T U R E S     */
+/*************************/
+
+static void write_record(FILE* f, const CaptureRecord& r) {
+    uint8_t t[4] = {(uint8_t)r.t_us, (uint8_t)(r.t_us >> 8), (uint8_t)(r.t_us >> 16), (uint8_t)(r.t_us >> 24)};
+    fwrite(t, 1, 4, f);
+    fwrite(r.report, 1, REPORT_LEN, f);
+}
+
+static bool read_record(FILE* f, CaptureRecord& r) {
+    uint8_t t[4];
+    if (fread(t, 1, 4, f) != 4 || fread(r.report, 1, REPORT_LEN, f) != (size_t)REPORT_LEN) return false;
+    r.t_us = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+    return true;
+}
+
+static uint32_t lcg = 7;
+static uint32_t rnd() {
+    lcg = lcg * 1103515245 + 12345;
+    return lcg >> 16;
+}
+
+// A trace the way a controller sends it: 800 Hz with arrival jitter and
+// Bluetooth bursts (several reports landing together), sticks sweeping,
+// buttons held for a while, one-report taps, chords and D-pad rolls
+static FILE* generate_trace() {
+    FILE* f = tmpfile();
+    fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), f);
+
+    CaptureRecord r;
+    memset(r.report, 0, sizeof(r.report));
+    r.report[17] = 8;                                  // D-pad released
+    uint32_t t = 0;
+    for (int i = 0; i < TRACE_REPORTS; i++) {
+        double s = i * 0.005;
+        r.report[13] = 128 + (int)(100 * sin(s));
+        r.report[14] = 128 + (int)(100 * cos(s * 0.7));
+        r.report[15] = 128 + (int)(60 * sin(s * 1.3));
+        r.report[16] = 128 - (int)(60 * cos(s * 0.4));
+        r.report[20] = rnd();
+        r.report[21] = rnd();
+
+        uint32_t roll = rnd() % 16;
+        if (roll == 0) {
+            // New random state: any face buttons, D-pad code 0-8, shoulders, PS
+            r.report[17] = (rnd() & 0xF0) | (rnd() % 9);
+            r.report[18] = rnd();
+            r.report[19] = rnd() & 3;
+        } else if (roll == 1) {
+            r.report[17] = (r.report[17] & 0xF0) | ((r.report[17] + 1) % 9);   // D-pad roll
+        } else if (roll == 2) {
+            r.report[18] ^= 1 << (rnd() % 8);          // one shoulder/stick button
+        }
+
+        // Some reports arrive in the same burst as the one before
+        if (i && rnd() % 10 == 0) t += 20;
+        else t = i * REPORT_PERIOD_US + rnd() % 400;
+        r.t_us = t;
+        write_record(f, r);
+
+        // One-report tap: pressed here, released in the next report
+        if (rnd() % 50 == 0) {
+            r.report[17] ^= 0x20;                      // cross
+            r.report[19] ^= 0x02;                      // touchpad
+        }
+    }
+    rewind(f);
+    return f;
+}
+
+/*************************/
+/*   R E F E R E N C E   */
+/*************************/
+
+// Straight per-button decode of a report, independent of the parser
+static uint32_t reference_buttons(const uint8_t* p) {
+    uint32_t b = 0;
+    switch (p[17] & 0x0F) {
+        case 0: b |= PS4_BUTTON_UP; break;
+        case 1: b |= PS4_BUTTON_UPRIGHT; break;
+        case 2: b |= PS4_BUTTON_RIGHT; break;
+        case 3: b |= PS4_BUTTON_DOWNRIGHT; break;
+        case 4: b |= PS4_BUTTON_DOWN; break;
+        case 5: b |= PS4_BUTTON_DOWNLEFT; break;
+        case 6: b |= PS4_BUTTON_LEFT; break;
+        case 7: b |= PS4_BUTTON_UPLEFT; break;
+        default: break;
+    }
+    if (p[17] & 0x10) b |= PS4_BUTTON_SQUARE;
+    if (p[17] & 0x20) b |= PS4_BUTTON_CROSS;
+    if (p[17] & 0x40) b |= PS4_BUTTON_CIRCLE;
+    if (p[17] & 0x80) b |= PS4_BUTTON_TRIANGLE;
+    if (p[18] & 0x01) b |= PS4_BUTTON_L1;
+    if (p[18] & 0x02) b |= PS4_BUTTON_R1;
+    if (p[18] & 0x04) b |= PS4_BUTTON_L2;
+    if (p[18] & 0x08) b |= PS4_BUTTON_R2;
+    if (p[18] & 0x10) b |= PS4_BUTTON_SHARE;
+    if (p[18] & 0x20) b |= PS4_BUTTON_OPTIONS;
+    if (p[18] & 0x40) b |= PS4_BUTTON_L3;
+    if (p[18] & 0x80) b |= PS4_BUTTON_R3;
+    if (p[19] & 0x01) b |= PS4_BUTTON_PS;
+    if (p[19] & 0x02) b |= PS4_BUTTON_TOUCHPAD;
+    return b;
+}
+
+/*********************/
+/*   R E P L A Y     */
+/*********************/
+
+struct ReplayStats {
+    unsigned long reports;
+    unsigned long events;
+    unsigned long connects;
+    unsigned long edge_errors;
+    unsigned long state_errors;
+    unsigned long presses;
+    unsigned long releases;
+    uint64_t parse_us;                  // time spent inside parsePacket
+    uint64_t wall_us;
+    uint32_t trace_us;                  // capture length
+    uint32_t latency_max_us;
+    uint32_t latency[TRACE_REPORTS * 4];
+};
+
+static ReplayStats stats;
+static uint32_t expect_buttons;
+static uint32_t expect_prev;
+static uint64_t due_us;                 // when the current report "arrived"
+
+static void on_event(ps4_t ps4, ps4_event_t event) {
+    uint32_t lat = (uint32_t)(now_us() - due_us);
+    if (stats.events < sizeof(stats.latency) / sizeof(stats.latency[0])) stats.latency[stats.events] = lat;
+    if (lat > stats.latency_max_us) stats.latency_max_us = lat;
+    stats.events++;
+
+    uint32_t down = expect_buttons & ~expect_prev;
+    uint32_t up = expect_prev & ~expect_buttons;
+    if (ps4.button != expect_buttons) stats.state_errors++;
+    if (event.button_down != down || event.button_up != up) stats.edge_errors++;
+    stats.presses += __builtin_popcount(event.button_down);
+    stats.releases += __builtin_popcount(event.button_up);
+}
+
+static void on_connect(uint8_t connected) {
+    if (connected) stats.connects++;
+}
+
+// speed: 1 = real time, N = N times faster, 0 = as fast as possible
+static void replay(FILE* f, double speed) {
+    char magic[sizeof(CAPTURE_MAGIC)];
+    TEST_ASSERT_EQUAL(sizeof(magic), fread(magic, 1, sizeof(magic), f));
+    TEST_ASSERT_EQUAL_MEMORY(CAPTURE_MAGIC, magic, sizeof(magic));
+
+    memset(&stats, 0, sizeof(stats));
+    ps4ConnectEvent(0);                 // next report is a fresh connection
+    ps4SetConnectionCallback(on_connect);
+    ps4SetEventCallback(on_event);
+
+    CaptureRecord r;
+    uint64_t start = now_us();
+    while (read_record(f, r)) {
+        if (speed > 0) {
+            due_us = start + (uint64_t)(r.t_us / speed);
+            while (now_us() < due_us) {}
+        }
+        expect_prev = expect_buttons;
+        expect_buttons = reference_buttons(r.report);
+
+        uint64_t t0 = now_us();
+        if (speed <= 0) due_us = t0;
+        parsePacket(r.report);
+        stats.parse_us += now_us() - t0;
+        stats.reports++;
+        stats.trace_us = r.t_us;
+    }
+    stats.wall_us = now_us() - start;
+}
+
+static int cmp_u32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a, y = *(const uint32_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static void print_stats(const char* name) {
+    unsigned long n = stats.events < sizeof(stats.latency) / sizeof(stats.latency[0]) ?
+        stats.events : sizeof(stats.latency) / sizeof(stats.latency[0]);
+    qsort(stats.latency, n, sizeof(stats.latency[0]), cmp_u32);
+    printf("%s: %lu reports in %.3f s (trace %.3f s), parse %.0f reports/s, "
+           "latency p50 %u us p99 %u us max %u us, %lu presses %lu releases, "
+           "%lu edge errors\n",
+           name, stats.reports, stats.wall_us / 1e6, stats.trace_us / 1e6,
+           stats.parse_us ? stats.reports * 1e6 / stats.parse_us : 0.0,
+           n ? stats.latency[n / 2] : 0, n ? stats.latency[n * 99 / 100] : 0,
+           stats.latency_max_us, stats.presses, stats.releases, stats.edge_errors);
+}
+
+// Every report after the first is one event with the right state and edges;
+// the first one after connecting is reported as the connection instead
+static void check_replay(unsigned long reports) {
+    TEST_ASSERT_EQUAL(reports, stats.reports);
+    TEST_ASSERT_EQUAL(1, stats.connects);
+    TEST_ASSERT_EQUAL(reports - 1, stats.events);
+    TEST_ASSERT_EQUAL(0, stats.state_errors);
+    TEST_ASSERT_EQUAL(0, stats.edge_errors);
+}
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void test_replay_flat_out(void) {
+    FILE* f = generate_trace();
+    replay(f, 0);
+    fclose(f);
+    print_stats("flat out");
+    check_replay(TRACE_REPORTS);
+    TEST_ASSERT_GREATER_THAN(100, stats.presses);
+    TEST_ASSERT_GREATER_THAN(100, stats.releases);
+    // Far above the 800 reports/s a controller can send
+    TEST_ASSERT_GREATER_THAN(800 * 100, stats.reports * 1e6 / stats.parse_us);
+}
+
+void test_replay_accelerated(void) {
+    FILE* f = generate_trace();
+    replay(f, 10);
+    fclose(f);
+    print_stats("10x");
+    check_replay(TRACE_REPORTS);
+    // Paced by the capture timestamps, not by the parser
+    TEST_ASSERT_GREATER_OR_EQUAL(stats.trace_us / 10, stats.wall_us);
+}
+
+void test_replay_real_time(void) {
+    FILE* f = generate_trace();
+    replay(f, 1);
+    fclose(f);
+    print_stats("real time");
+    check_replay(TRACE_REPORTS);
+    TEST_ASSERT_GREATER_OR_EQUAL(stats.trace_us, stats.wall_us);
+    TEST_ASSERT_LESS_THAN(stats.trace_us + 500000, stats.wall_us);
+}
+
+// Single-report taps and presses at the same time as releases: XOR edges
+// must report both directions in the same event, and nothing else
+void test_edges(void) {
+    FILE* f = tmpfile();
+    fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), f);
+    CaptureRecord r;
+    memset(&r, 0, sizeof(r));
+    const uint8_t seq[][3] = {
+        {0x08, 0x00, 0x00},             // connect, nothing pressed
+        {0x28, 0x00, 0x00},             // cross down
+        {0x08, 0x00, 0x00},             // cross up
+        {0x40, 0x01, 0x00},             // circle + L1 down, D-pad up down
+        {0x42, 0x02, 0x01},             // D-pad up -> right, L1 up, R1 + PS down
+        {0x48, 0x02, 0x03},             // D-pad released, touchpad down
+        {0x88, 0x00, 0x00},             // circle up, triangle down, R1/PS/touchpad up
+        {0x88, 0x00, 0x00},             // no change
+    };
+    const int n = sizeof(seq) / sizeof(seq[0]);
+    for (int i = 0; i < n; i++) {
+        r.t_us = i * REPORT_PERIOD_US;
+        memcpy(r.report + 17, seq[i], 3);
+        write_record(f, r);
+    }
+    rewind(f);
+    replay(f, 0);
+    fclose(f);
+    check_replay(n);
+    // Presses: cross, circle, L1, up, right, R1, PS, touchpad, triangle;
+    // everything but triangle is released again
+    TEST_ASSERT_EQUAL(9, stats.presses);
+    TEST_ASSERT_EQUAL(8, stats.releases);
+}
+
+// A capture recorded on the robot, when one is given
+void test_replay_capture_file(void) {
+    const char* path = getenv("PS4_REPLAY_CAPTURE");
+    if (!path) TEST_IGNORE_MESSAGE("PS4_REPLAY_CAPTURE not set");
+    FILE* f = fopen(path, "rb");
+    TEST_ASSERT_NOT_NULL(f);
+    replay(f, 0);
+    fclose(f);
+    print_stats(path);
+    check_replay(stats.reports);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_edges);
+    RUN_TEST(test_replay_flat_out);
+    RUN_TEST(test_replay_accelerated);
+    RUN_TEST(test_replay_real_time);
+    RUN_TEST(test_replay_capture_file);
+    return UNITY_END();
+}
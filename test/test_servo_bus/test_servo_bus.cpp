@@ -0,0 +1,292 @@
+// Servo bus benchmark against SCSim: transactions/s and per-transaction
+// time histograms at 1 Mbaud, plus the reply paths (sync read, dead IDs)
+// and the SCSBus scheduler
+#include <stdio.h>
+#include <unity.h>
+
+#include "SCServo.h"
+
+static const int SERVOS = 8;
+static const int BENCH_N = 1000;
+
+static const unsigned long HIST_BIN_US = 50;
+static const int HIST_BINS = 40;  // last bin collects everything slower
+
+static SCSim sim;
+static SMS_STS st;
+static u8 ids[SERVOS] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+struct TickHist {
+    unsigned long n;
+    unsigned long total_us;
+    unsigned long min_us;
+    unsigned long max_us;
+    unsigned long bin[HIST_BINS];
+};
+
+static void hist_add(TickHist &h, unsigned long us) {
+    if (!h.n || us < h.min_us) h.min_us = us;
+    if (us > h.max_us) h.max_us = us;
+    h.n++;
+    h.total_us += us;
+    unsigned long b = us / HIST_BIN_US;
+    h.bin[b < (unsigned long)HIST_BINS ? b : HIST_BINS - 1]++;
+}
+
+static void hist_print(const char *name, const TickHist &h) {
+    printf("%s: %lu tx, %.0f tx/s, mean %.1f us, min %lu us, max %lu us\n",
+           name, h.n, h.total_us ? h.n * 1e6 / h.total_us : 0.0, (double)h.total_us / h.n,
+           h.min_us, h.max_us);
+    for (int b = 0; b < HIST_BINS; b++) {
+        if (!h.bin[b]) continue;
+        if (b == HIST_BINS - 1)
+            printf("  >=%4lu us  %lu\n", b * HIST_BIN_US, h.bin[b]);
+        else
+            printf("  %4lu-%4lu us  %lu\n", b * HIST_BIN_US, (b + 1) * HIST_BIN_US - 1, h.bin[b]);
+    }
+}
+
+// Runs op n times, timing each call; every call must report success
+template <typename Op>
+static TickHist bench(const char *name, int n, Op op) {
+    TickHist h = {};
+    for (int i = 0; i < n; i++) {
+        unsigned long t0 = micros();
+        int ok = op(i);
+        hist_add(h, micros() - t0);
+        TEST_ASSERT_TRUE_MESSAGE(ok, name);
+    }
+    hist_print(name, h);
+    return h;
+}
+
+// Wire time of n bytes at the simulated baud (10 bits per byte)
+static unsigned long wire_us(int n) {
+    return n * 10000000UL / sim.Baud;
+}
+
+void setUp(void) {
+    sim = SCSim();
+    for (int i = 0; i < SERVOS; i++) sim.addServo(ids[i]);
+    st = SMS_STS();
+    st.pSim = &sim;
+}
+
+void tearDown(void) {}
+
+void test_write_pos_ex(void) {
+    TickHist h = bench("WritePosEx", BENCH_N, [](int i) {
+        return st.WritePosEx(ids[i % SERVOS], 1000 + i, 0, 0) == 1;
+    });
+    // 13-byte instruction, 6-byte status reply
+    TEST_ASSERT_GREATER_OR_EQUAL(wire_us(13 + 6) + sim.latencyUs, h.min_us);
+    u8 *m = sim.Mem(ids[(BENCH_N - 1) % SERVOS]);
+    TEST_ASSERT_EQUAL(1000 + BENCH_N - 1, m[SMS_STS_GOAL_POSITION_L] | (m[SMS_STS_GOAL_POSITION_H] << 8));
+}
+
+void test_sync_write_pos_ex(void) {
+    s16 pos[SERVOS];
+    u16 speed[SERVOS] = {0};
+    u8 acc[SERVOS] = {0};
+    TickHist h = bench("SyncWritePosEx x8", BENCH_N, [&](int i) {
+        for (int s = 0; s < SERVOS; s++) pos[s] = 1000 + 100 * s + (i & 63);
+        st.SyncWritePosEx(ids, SERVOS, pos, speed, acc);
+        return true;
+    });
+    // Broadcast, no reply; back-to-back frames are paced by the wire once the
+    // TX FIFO fills
+    TEST_ASSERT_GREATER_OR_EQUAL(wire_us(8 + SERVOS * 8) * 9 / 10, h.total_us / h.n);
+    for (int s = 0; s < SERVOS; s++) {
+        u8 *m = sim.Mem(ids[s]);
+        TEST_ASSERT_EQUAL(pos[s], m[SMS_STS_GOAL_POSITION_L] | (m[SMS_STS_GOAL_POSITION_H] << 8));
+    }
+}
+
+void test_feedback(void) {
+    sim.Mem(3)[SMS_STS_PRESENT_VOLTAGE] = 118;
+    TickHist h = bench("FeedBack", BENCH_N, [](int i) {
+        return st.FeedBack(ids[i % SERVOS]) > 0;
+    });
+    // 8-byte read, 6 + 15 byte reply
+    TEST_ASSERT_GREATER_OR_EQUAL(wire_us(8 + 6 + 15) + sim.latencyUs, h.min_us);
+    TEST_ASSERT_TRUE(st.FeedBack(3) > 0);
+    TEST_ASSERT_EQUAL(2048, st.ReadPos(-1));
+    TEST_ASSERT_EQUAL(118, st.ReadVoltage(-1));
+}
+
+void test_ping(void) {
+    TickHist h = bench("Ping", BENCH_N, [](int i) {
+        return st.Ping(ids[i % SERVOS]) == ids[i % SERVOS];
+    });
+    TEST_ASSERT_GREATER_OR_EQUAL(wire_us(6 + 6) + sim.latencyUs, h.min_us);
+}
+
+void test_sync_feedback(void) {
+    s16 pos[SERVOS];
+    u16 speed[SERVOS] = {0};
+    u8 acc[SERVOS] = {0};
+    for (int s = 0; s < SERVOS; s++) pos[s] = 1000 + 100 * s;
+    st.SyncWritePosEx(ids, SERVOS, pos, speed, acc);
+
+    SMS_STS_FeedBack fb;
+    bench("SyncFeedBack x8", BENCH_N / 10, [&](int) {
+        return st.SyncFeedBack(ids, SERVOS, &fb) == SERVOS;
+    });
+    TEST_ASSERT_EQUAL(SERVOS, fb.IDN);
+    for (int s = 0; s < SERVOS; s++) {
+        TEST_ASSERT_TRUE(fb.Ok[s]);
+        TEST_ASSERT_EQUAL(ids[s], fb.ID[s]);
+        TEST_ASSERT_EQUAL(120, fb.Voltage[s]);
+    }
+}
+
+// An ID that never answers costs the full timeout SCS_LINK_TRIP times, then
+// the breaker opens and the bus skips it until the retry time
+void test_tripped_id(void) {
+    const u8 dead = 9;
+    for (int i = 0; i < SCS_LINK_TRIP; i++) {
+        unsigned long t0 = micros();
+        TEST_ASSERT_EQUAL(-1, st.Ping(dead));
+        TEST_ASSERT_GREATER_OR_EQUAL(st.IOTimeOut, micros() - t0);
+    }
+    TEST_ASSERT_EQUAL(SCS_LINK_TRIP, st.Link[dead].Fails);
+    TEST_ASSERT_FALSE(st.linkOnline(dead));
+
+    TickHist h = bench("Ping tripped ID", BENCH_N, [](int) {
+        return st.Ping(dead) == -1;
+    });
+    TEST_ASSERT_LESS_THAN(st.IOTimeOut / 10, h.max_us);
+    TEST_ASSERT_EQUAL(0, st.FeedBack(dead) > 0);
+
+    // Live IDs are unaffected
+    TEST_ASSERT_EQUAL(4, st.Ping(4));
+
+    // Once the retry time passes one probe goes out; a servo that came back
+    // closes the breaker again
+    sim.addServo(dead);
+    st.Link[dead].retryAt = micros();
+    TEST_ASSERT_EQUAL(dead, st.Ping(dead));
+    TEST_ASSERT_EQUAL(0, st.Link[dead].Fails);
+    TEST_ASSERT_TRUE(st.linkOnline(dead));
+}
+
+// Reads queued before the first submit go out with it
+void test_bus_read_queued_before_hold(void) {
+    SCSBus bus(&st);
+    u8 d[2] = {0};
+    u8 ok = 9;
+    TEST_ASSERT_EQUAL(1, bus.read(4, SMS_STS_PRESENT_POSITION_L, 2, d, &ok));
+    TEST_ASSERT_EQUAL(0, bus.run());
+    TEST_ASSERT_EQUAL(1, ok);
+    TEST_ASSERT_EQUAL(2048, d[0] | (d[1] << 8));
+
+    // And with hold() called explicitly after queueing
+    ok = 9;
+    bus.read(5, SMS_STS_PRESENT_POSITION_L, 2, d, &ok);
+    bus.hold();
+    TEST_ASSERT_EQUAL(0, bus.run());
+    TEST_ASSERT_EQUAL(1, ok);
+    TEST_ASSERT_EQUAL(0, bus.Timeouts);
+}
+
+// The firmware's feedback tick: position frame held, sync read queued behind
+// it, one write; compared with the frame and SyncFeedBack back to back
+void test_bus_frame_with_feedback(void) {
+    SCSBus bus(&st);
+    s16 pos[SERVOS];
+    u16 speed[SERVOS] = {0};
+    u8 acc[SERVOS] = {0};
+    u8 raw[SERVOS * SMS_STS_FEEDBACK_LEN];
+    u8 ok[SERVOS];
+    SMS_STS_FeedBack fb;
+
+    bench("SyncWritePosEx+SyncFeedBack", BENCH_N / 10, [&](int i) {
+        for (int s = 0; s < SERVOS; s++) pos[s] = 1000 + 100 * s + (i & 7);
+        st.SyncWritePosEx(ids, SERVOS, pos, speed, acc);
+        return st.SyncFeedBack(ids, SERVOS, &fb) == SERVOS;
+    });
+    TickHist h = bench("SCSBus frame+sync read", BENCH_N / 10, [&](int i) {
+        bus.hold();
+        for (int s = 0; s < SERVOS; s++) pos[s] = 1000 + 100 * s + (i & 7);
+        st.SyncWritePosEx(ids, SERVOS, pos, speed, acc);
+        bus.syncRead(ids, SERVOS, SMS_STS_PRESENT_POSITION_L, SMS_STS_FEEDBACK_LEN, raw, ok);
+        return bus.run() == 0;
+    });
+    printf("SCSBus utilisation %d permille\n", bus.Utilisation());
+
+    // Frame (72 bytes) + sync read (16) + 8 replies of 6 + 15 bytes
+    TEST_ASSERT_GREATER_OR_EQUAL(wire_us(72 + 16 + SERVOS * 21), h.min_us);
+    TEST_ASSERT_EQUAL(SERVOS, st.FeedBackDecode(ids, SERVOS, raw, ok, &fb));
+    for (int s = 0; s < SERVOS; s++) {
+        TEST_ASSERT_EQUAL(ids[s], fb.ID[s]);
+        TEST_ASSERT_EQUAL(120, fb.Voltage[s]);
+        u8 *m = sim.Mem(ids[s]);
+        TEST_ASSERT_EQUAL(pos[s], m[SMS_STS_GOAL_POSITION_L] | (m[SMS_STS_GOAL_POSITION_H] << 8));
+    }
+}
+
+// A missing ID in a sync read times out alone; the others are delivered
+void test_bus_missing_id(void) {
+    SCSBus bus(&st);
+    u8 read_ids[3] = {2, 9, 3};
+    u8 raw[3 * 2];
+    u8 ok[3];
+    bus.syncRead(read_ids, 3, SMS_STS_PRESENT_POSITION_L, 2, raw, ok);
+    TEST_ASSERT_EQUAL(1, bus.run());
+    TEST_ASSERT_EQUAL(1, ok[0]);
+    TEST_ASSERT_EQUAL(0, ok[1]);
+    TEST_ASSERT_EQUAL(1, ok[2]);
+    TEST_ASSERT_EQUAL(1, st.Link[9].Fails);
+}
+
+// A dropped reply on the scheduler path costs the ID's learned timeout, as
+// it does through SMS_STS, not the full IOTimeOut
+void test_bus_dropped_reply_timeout(void) {
+    SCSBus bus(&st);
+    u8 d[2];
+    u8 ok;
+    // A failure falls back to IOTimeOut, so each drop starts from fresh stats
+    auto learn = [&]() {
+        st.linkReset();
+        sim.dropPerMille = 0;
+        for (int i = 0; i < 20; i++) {
+            bus.read(4, SMS_STS_PRESENT_POSITION_L, 2, d, &ok);
+            TEST_ASSERT_EQUAL(0, bus.run());
+        }
+        sim.dropPerMille = 1000;
+        return st.linkTimeOut(4);
+    };
+
+    unsigned long learned = learn();
+    TEST_ASSERT_LESS_THAN(st.IOTimeOut / 2, learned);
+    unsigned long t0 = micros();
+    TEST_ASSERT_EQUAL(-1, st.ReadPos(4));
+    unsigned long direct_us = micros() - t0;
+
+    learn();
+    bus.read(4, SMS_STS_PRESENT_POSITION_L, 2, d, &ok);
+    t0 = micros();
+    TEST_ASSERT_EQUAL(1, bus.run());
+    unsigned long bus_us = micros() - t0;
+    printf("dropped reply: learned timeout %lu us, ReadPos %lu us, SCSBus %lu us\n",
+           learned, direct_us, bus_us);
+    TEST_ASSERT_EQUAL(0, ok);
+    // The bus also counts its 8-byte request on the wire
+    TEST_ASSERT_LESS_THAN(direct_us + wire_us(8) + 100, bus_us);
+    TEST_ASSERT_EQUAL(st.IOTimeOut, st.rxTimeOut);
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_write_pos_ex);
+    RUN_TEST(test_sync_write_pos_ex);
+    RUN_TEST(test_feedback);
+    RUN_TEST(test_ping);
+    RUN_TEST(test_sync_feedback);
+    RUN_TEST(test_tripped_id);
+    RUN_TEST(test_bus_read_queued_before_hold);
+    RUN_TEST(test_bus_frame_with_feedback);
+    RUN_TEST(test_bus_missing_id);
+    RUN_TEST(test_bus_dropped_reply_timeout);
+    return UNITY_END();
+}
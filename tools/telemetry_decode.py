@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Decode the robot's binary SerialBT telemetry (see src/telemetry.h).
+
+Usage:
+  telemetry_decode.py /dev/rfcomm0          read a serial port (needs pyserial)
+  telemetry_decode.py capture.bin           read a raw capture file
+  telemetry_decode.py --csv capture.bin     one CSV line per record
+"""
+
+import struct
+import sys
+
+VERSION = 2
+TYPE_STATE = 1
+SERVO_COUNT = 8
+GAITS = ["CREEP_FORWARD", "CREEP_BACKWARD", "CREEP_RIGHT", "CREEP_LEFT",
+         "CREEP_STRAFE_RIGHT", "CREEP_STRAFE_LEFT",
+         "TROT_FORWARD", "TROT_BACKWARD", "TROT_RIGHT", "TROT_LEFT",
+         "TROT_STRAFE_RIGHT", "TROT_STRAFE_LEFT"]
+
+HEADER = struct.Struct("<BBHI")
+STATE = struct.Struct("<BBHBB8hIIIHHHBH")
+SERVO = struct.Struct("<hhhBB")
+
+
+def crc16_ccitt(data):
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else crc << 1
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame) + 1:
+            raise ValueError("bad COBS code")
+        out += frame[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+
+def decode(payload):
+    if len(payload) < HEADER.size + 2:
+        raise ValueError("short frame")
+    body, crc = payload[:-2], struct.unpack("<H", payload[-2:])[0]
+    if crc16_ccitt(body) != crc:
+        raise ValueError("crc mismatch")
+
+    version, kind, seq, stamp_ms = HEADER.unpack_from(body)
+    if version != VERSION:
+        raise ValueError("unsupported version %d" % version)
+    if kind != TYPE_STATE:
+        raise ValueError("unknown record type %d" % kind)
+
+    f = STATE.unpack_from(body, HEADER.size)
+    rec = {
+        "seq": seq,
+        "stamp_ms": stamp_ms,
+        "gait": GAITS[f[0]] if f[0] < len(GAITS) else str(f[0]),
+        "running": bool(f[1] & 1),
+        "phase": f[2] / 65536.0,
+        "h": f[3],
+        "t_cycle": f[4] / 10.0,
+        "commanded": list(f[5:13]),
+        "ticks": f[13],
+        "overruns": f[14],
+        "missed": f[15],
+        "jitter_avg_us": f[16],
+        "jitter_max_us": f[17],
+        "exec_max_us": f[18],
+        "feedback_age_ms": f[20],
+        "servos": [],
+    }
+    ok_mask = f[19]
+    off = HEADER.size + STATE.size
+    for i in range(SERVO_COUNT):
+        pos, load, current, temp, volt = SERVO.unpack_from(body, off)
+        off += SERVO.size
+        if ok_mask & (1 << i):
+            rec["servos"].append({"id": i + 1, "pos": pos, "load": load,
+                                  "current": current, "temp": temp, "volt": volt / 10.0})
+    return rec
+
+
+def frames(stream, follow=False):
+    buf = bytearray()
+    while True:
+        chunk = stream.read(256)
+        if not chunk:
+            # A serial port returns b"" when its read timeout expires; only a
+            # file is finished at that point
+            if follow:
+                continue
+            return
+        buf += chunk
+        while True:
+            end = buf.find(b"\x00")
+            if end < 0:
+                break
+            frame, buf = bytes(buf[:end]), buf[end + 1:]
+            if frame:
+                yield frame
+
+
+def csv_line(rec):
+    cols = [rec["seq"], rec["stamp_ms"], rec["gait"], int(rec["running"]),
+            "%.4f" % rec["phase"], rec["h"], rec["t_cycle"]]
+    cols += rec["commanded"]
+    cols += [rec["ticks"], rec["overruns"], rec["missed"],
+             rec["jitter_avg_us"], rec["jitter_max_us"], rec["exec_max_us"],
+             rec["feedback_age_ms"]]
+    for s in rec["servos"]:
+        cols += [s["id"], s["pos"], s["load"], s["current"], s["temp"], s["volt"]]
+    return ",".join(str(c) for c in cols)
+
+
+def is_port(path):
+    return path.startswith("/dev/") or path.upper().startswith("COM")
+
+
+def open_source(path):
+    if is_port(path):
+        import serial
+        return serial.Serial(path, 115200, timeout=1)
+    return open(path, "rb")
+
+
+def main(argv):
+    as_csv = "--csv" in argv
+    args = [a for a in argv if a != "--csv"]
+    if len(args) != 1:
+        print(__doc__.strip())
+        return 1
+
+    bad = 0
+    with open_source(args[0]) as src:
+        for frame in frames(src, follow=is_port(args[0])):
+            try:
+                rec = decode(cobs_decode(frame))
+            except (ValueError, struct.error) as e:
+                bad += 1
+                print("# dropped frame: %s" % e, file=sys.stderr)
+                continue
+            print(csv_line(rec) if as_csv else rec, flush=True)
+
+    if bad:
+        print("# %d bad frames" % bad, file=sys.stderr)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))